@@ -0,0 +1,127 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file boxcar_filter.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_BOXCAR_FILTER_H
+#define ROSFLIGHT_IO_BOXCAR_FILTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace rosflight_io
+{
+/**
+ * @class BoxcarFilter
+ * @brief Averaging decimator for multi-channel sensor streams.
+ *
+ * Averages every sample that falls into a fixed-length time window and outputs one sample per
+ * window. A boxcar average acts as the anti-aliasing low-pass filter for the decimation, so a
+ * topic published at a lower rate does not alias content above its new Nyquist frequency the way
+ * dropping samples would.
+ *
+ * Windows are aligned to the sample timestamps rather than arrival times, so transport jitter
+ * does not change which samples are averaged together. A window is output when the first sample
+ * of the next window arrives, delaying the output by one input sample.
+ */
+class BoxcarFilter
+{
+public:
+  /**
+   * @brief Constructor for BoxcarFilter.
+   *
+   * The filter starts disabled, passing every sample straight through.
+   *
+   * @param num_channels Number of values in each sample.
+   */
+  explicit BoxcarFilter(size_t num_channels);
+
+  /**
+   * @brief Sets the output rate of the filter.
+   *
+   * Discards any partially accumulated window.
+   *
+   * @param rate_hz Output rate in Hz. A rate of 0 or less disables the filter.
+   */
+  void set_rate(double rate_hz);
+
+  /**
+   * @brief Checks if the filter is decimating its input.
+   * @return True if an output rate has been set, false if samples are passed straight through.
+   */
+  bool enabled() const { return period_.count() > 0; }
+
+  /**
+   * @brief Adds a sample to the filter.
+   *
+   * When the sample falls past the end of the current window, the average of that window is
+   * written to the outputs and the sample starts the next window. If the filter is disabled,
+   * every sample is written straight to the outputs.
+   *
+   * The sample and output buffers are owned by the caller, so no memory is allocated per sample.
+   *
+   * @param time Timestamp of the sample.
+   * @param sample Sample values, must contain num_channels values.
+   * @param output_time Mean timestamp of the averaged samples, written when a window completes.
+   * @param output Averaged sample values, must have room for num_channels values. Written when a
+   * window completes.
+   * @return True if a window was completed and the outputs were written, false otherwise.
+   */
+  bool update(std::chrono::nanoseconds time, const double * sample,
+              std::chrono::nanoseconds & output_time, double * output);
+
+  /**
+   * @brief Discards any partially accumulated window.
+   */
+  void reset();
+
+private:
+  /// Length of an averaging window, 0 if the filter is disabled.
+  std::chrono::nanoseconds period_;
+  /// End of the current window.
+  std::chrono::nanoseconds window_end_;
+  /// Sum of the sample values in the current window.
+  std::vector<double> sum_;
+  /// Sum of the sample timestamps in the current window, relative to the start of the window.
+  std::chrono::nanoseconds time_sum_;
+  /// Number of samples in the current window.
+  size_t count_;
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_BOXCAR_FILTER_H
@@ -0,0 +1,177 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file imu_temp_cal.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_IMU_TEMP_CAL_H
+#define ROSFLIGHT_IO_IMU_TEMP_CAL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
+#include <rclcpp/rclcpp.hpp>
+
+#include <rosflight_io/recursive_least_squares.hpp>
+#include <rosflight_msgs/srv/param_get_many.hpp>
+#include <rosflight_msgs/srv/param_set_many.hpp>
+
+#include <sensor_msgs/msg/imu.hpp>
+#include <sensor_msgs/msg/temperature.hpp>
+
+namespace rosflight_io
+{
+/**
+ * @class CalibrateImuTemp
+ * @brief Used to determine and set IMU temperature compensation constants in firmware.
+ *
+ * The firmware models the accelerometer bias of each axis as ACC_*_TEMP_COMP * temperature +
+ * ACC_*_BIAS. This class resets those parameters, then fits the model to the IMU data streamed by
+ * rosflight_io while the IMU heats up or cools down, with the vehicle level and still. The fit is
+ * recursive, so its memory does not grow over multi-hour soaks. The gyro bias is fit the same way
+ * and reported, but the firmware has no gyro temperature compensation parameters to set. If the
+ * calibration fails or is interrupted, the previous values of the parameters are restored.
+ */
+class CalibrateImuTemp : public rclcpp::Node
+{
+public:
+  /**
+   * @brief Default constructor for CalibrateImuTemp.
+   */
+  CalibrateImuTemp();
+
+  /**
+   * @brief Main run function for IMU temperature calibration.
+   */
+  void run();
+
+  /**
+   * @brief Stops a calibration in progress, restoring the previous calibration parameters.
+   *
+   * Only sets a flag, so it is safe to call from a signal handler.
+   */
+  static void interrupt() { interrupted_ = true; }
+
+private:
+  /// Standard gravity, the specific force the accelerometer measures along -z when level.
+  static constexpr double GRAVITY = 9.80665;
+  /// Smallest temperature range (degrees) that gives a usable fit of the temperature coefficients.
+  static constexpr double MIN_TEMPERATURE_SPAN = 2.0;
+  /// Time to wait for a parameter service response, which includes the firmware confirming sets.
+  static constexpr std::chrono::seconds SERVICE_TIMEOUT{10};
+
+  /// Names of the calibration parameters: the temperature coefficients, then the biases.
+  inline static const std::vector<std::string> CALIBRATION_PARAMS = {
+    "ACC_X_TEMP_COMP", "ACC_Y_TEMP_COMP", "ACC_Z_TEMP_COMP", "ACC_X_BIAS", "ACC_Y_BIAS",
+    "ACC_Z_BIAS"};
+
+  /**
+   * @brief Callback function for the synchronized "imu/data" and "imu/temperature" topics.
+   *
+   * Adds the sample to the fits, unless the vehicle is rotating, and ends the calibration once
+   * the temperature span is reached or the calibration time has completed.
+   *
+   * @param imu ROS Imu message object.
+   * @param temperature ROS Temperature message object, with the same timestamp.
+   */
+  void imu_callback(const sensor_msgs::msg::Imu::ConstSharedPtr & imu,
+                    const sensor_msgs::msg::Temperature::ConstSharedPtr & temperature);
+
+  /**
+   * @brief Set several ROSflight parameters in one request.
+   *
+   * @param names Names of parameters to set.
+   * @param values Values to set parameters to.
+   * @return True if every parameter exists and was confirmed by the firmware.
+   */
+  bool set_params(const std::vector<std::string> & names, const std::vector<double> & values);
+
+  /**
+   * @brief Get several ROSflight parameters in one request.
+   *
+   * @param names Names of parameters to get.
+   * @param values Filled with the value of each parameter.
+   * @return True if every parameter exists.
+   */
+  bool get_params(const std::vector<std::string> & names, std::vector<double> * values);
+
+  /**
+   * @brief Sets the calibration parameters back to the values they had before the calibration.
+   *
+   * @param values Previous values of the calibration parameters.
+   */
+  void restore_params(const std::vector<double> & values);
+
+  /// "imu/data" ROS topic subscription.
+  message_filters::Subscriber<sensor_msgs::msg::Imu> imu_subscriber_;
+  /// "imu/temperature" ROS topic subscription.
+  message_filters::Subscriber<sensor_msgs::msg::Temperature> temperature_subscriber_;
+  /// Pairs the IMU and temperature messages published for the same IMU sample.
+  std::shared_ptr<message_filters::TimeSynchronizer<sensor_msgs::msg::Imu,
+                                                    sensor_msgs::msg::Temperature>>
+    synchronizer_;
+
+  /// "param_set_many" ROS service client, used for setting ROSflight params.
+  rclcpp::Client<rosflight_msgs::srv::ParamSetMany>::SharedPtr param_set_client_;
+  /// "param_get_many" ROS service client, used for reading the previous calibration.
+  rclcpp::Client<rosflight_msgs::srv::ParamGetMany>::SharedPtr param_get_client_;
+
+  /// Set by interrupt() to stop the calibration.
+  inline static std::atomic<bool> interrupted_{false};
+
+  /// Bias fits of the accelerometer x, y, z then gyro x, y, z, as offset and temperature slope.
+  std::array<RecursiveLeastSquares<2>, 6> fits_;
+
+  bool calibrating_;             ///< Flag for whether a calibration is currently in progress.
+  bool first_time_;              ///< Flag for waiting for first measurement for calibration.
+  double calibration_time_;      ///< Maximum seconds to record data for calibration.
+  double temperature_span_;      ///< Temperature range that ends the calibration, 0 to disable.
+  double max_gyro_rate_;         ///< Rotation rate (rad/s) above which samples are ignored.
+  double start_time_;            ///< Timestamp of first calibration measurement.
+  double reference_temperature_; ///< Temperature the fits are centered on, for conditioning.
+  double min_temperature_;       ///< Lowest temperature seen.
+  double max_temperature_;       ///< Highest temperature seen.
+  size_t num_rejected_;          ///< Number of samples ignored because the vehicle was rotating.
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_IMU_TEMP_CAL_H
@@ -0,0 +1,190 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file latency_tracker.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_LATENCY_TRACKER_H
+#define ROSFLIGHT_IO_LATENCY_TRACKER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include <rosflight_msgs/msg/command_latency.hpp>
+#include <rosflight_msgs/msg/latency_histogram.hpp>
+
+namespace rosflight_io
+{
+/**
+ * @class LatencyTracker
+ * @brief Measures the latency of offboard commands through the rosflight_io command path.
+ *
+ * Each command is followed through the following events:
+ * 1. The header stamp set by the sender of the command.
+ * 2. The command callback in ROSflightIO.
+ * 3. The MAVLink frame being queued in MavlinkComm.
+ * 4. The MAVLink frame being written to the port.
+ * 5. The first output_raw message received from the firmware after the write.
+ *
+ * The time between consecutive events is kept in a rolling window for each stage, from which
+ * histograms and percentiles are computed. Note that the last stage includes the period of the
+ * output_raw stream, not just the firmware's reaction time.
+ *
+ * All methods are thread safe, since the events are reported from both the ROS executor and the
+ * MAVLink I/O thread.
+ */
+class LatencyTracker
+{
+public:
+  /**
+   * @brief Stages of the command path, each measured from the end of the previous one.
+   */
+  enum Stage
+  {
+    HEADER_TO_CALLBACK,
+    CALLBACK_TO_ENQUEUE,
+    ENQUEUE_TO_WRITE,
+    WRITE_TO_RESPONSE,
+    TOTAL, ///< Header stamp to response.
+    NUM_STAGES
+  };
+
+  /**
+   * @brief Constructor for LatencyTracker.
+   * @param window_size Number of most recent samples each stage histogram is computed from.
+   */
+  explicit LatencyTracker(size_t window_size);
+
+  /**
+   * @brief Starts tracking a command. Must be called before the command is sent.
+   * @param header_stamp Header stamp of the command, or zero if the sender did not stamp it.
+   * @param callback_time ROS time the command callback was called.
+   * @param callback_steady_time Steady clock time the command callback was called, if it was not
+   * called just now (e.g. when the command was held back by the command scheduler).
+   */
+  void command_received(
+    const rclcpp::Time & header_stamp, const rclcpp::Time & callback_time,
+    std::chrono::steady_clock::time_point callback_steady_time = std::chrono::steady_clock::now());
+
+  /**
+   * @brief Records that the oldest unwritten command has been written to the port.
+   *
+   * Frames queued before that command was received are untraced resends and are ignored.
+   *
+   * @param enqueue_time Time the MAVLink frame was queued.
+   * @param write_time Time the MAVLink frame was written.
+   */
+  void command_written(std::chrono::steady_clock::time_point enqueue_time,
+                       std::chrono::steady_clock::time_point write_time);
+
+  /**
+   * @brief Records a response from the firmware, completing every command written before it.
+   * @return Timestamps of the commands completed by this response.
+   */
+  std::vector<rosflight_msgs::msg::CommandLatency> response_received();
+
+  /**
+   * @brief Computes the histogram of each stage over its rolling window.
+   * @param stamp Stamp for the message headers.
+   * @return One histogram message per stage, in Stage order.
+   */
+  std::vector<rosflight_msgs::msg::LatencyHistogram> get_histograms(const rclcpp::Time & stamp);
+
+  /**
+   * @brief Gets the name of a stage, as used in the histogram messages.
+   * @param stage Stage to get the name of.
+   * @return Name of the stage.
+   */
+  static const char * stage_name(Stage stage);
+
+  /**
+   * @brief Maximum number of commands waiting on each event before the oldest is dropped.
+   *
+   * Keeps memory bounded if the port stops writing or the firmware stops streaming output_raw.
+   */
+  static constexpr size_t MAX_PENDING_COMMANDS = 100;
+
+private:
+  /**
+   * @brief Timestamps of a command that has not completed the command path yet.
+   */
+  struct CommandRecord
+  {
+    rclcpp::Time header_stamp;
+    rclcpp::Time callback_time;
+    std::chrono::steady_clock::time_point callback_steady_time;
+    std::chrono::steady_clock::time_point enqueue_time;
+    std::chrono::steady_clock::time_point write_time;
+  };
+
+  /**
+   * @brief Adds a latency sample to the rolling window of a stage.
+   * @param stage Stage the sample belongs to.
+   * @param latency Latency in seconds.
+   */
+  void add_sample(Stage stage, double latency);
+
+  /**
+   * @brief Converts a steady clock time to ROS time, using the callback time of a command.
+   * @param record Command whose callback time is used as the reference.
+   * @param time Steady clock time to convert.
+   * @return ROS time corresponding to the steady clock time.
+   */
+  static rclcpp::Time to_ros_time(const CommandRecord & record,
+                                  std::chrono::steady_clock::time_point time);
+
+  /// Number of samples kept in each rolling window.
+  size_t window_size_;
+  /// Commands whose MAVLink frame has not been written yet, oldest first.
+  std::deque<CommandRecord> awaiting_write_;
+  /// Commands that have been written and are waiting on a response, oldest first.
+  std::deque<CommandRecord> awaiting_response_;
+  /// Rolling window of latency samples for each stage, in seconds.
+  std::array<std::deque<double>, NUM_STAGES> windows_;
+  /// Histogram bin edges shared by all stages, in seconds.
+  std::vector<double> bin_edges_;
+  /// Mutex protecting all of the above.
+  std::mutex mutex_;
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_LATENCY_TRACKER_H
@@ -44,13 +44,16 @@
 #include <message_filters/subscriber.h>
 #include <rclcpp/rclcpp.hpp>
 
-#include <rosflight_msgs/srv/param_set.hpp>
+#include <rosflight_io/sphere_coverage.hpp>
+#include <rosflight_msgs/msg/mag_calibration.hpp>
+#include <rosflight_msgs/srv/param_set_many.hpp>
 
 #include <sensor_msgs/msg/magnetic_field.hpp>
 
 #include <cmath>
 #include <eigen3/Eigen/Eigen>
 #include <random>
+#include <string>
 
 #include <eigen_stl_containers/eigen_stl_vector_container.h>
 #include <vector>
@@ -75,10 +78,87 @@ public:
 
   /**
    * @brief Main run function for magnetometer calibration.
+   *
+   * Calibrates the recorded captures in the "batch_files" parameter if there are any, or the
+   * connected vehicle otherwise.
    */
   void run();
 
 private:
+  /// Coefficients (a, b, c, f, g, h, p, q, r, d) of the quadric surface of eq. 1 of Li.
+  typedef Eigen::Matrix<double, 10, 1> Vector10d;
+  /// Scatter matrix D*D^T of a set of measurements, from eq. 11 of Li.
+  typedef Eigen::Matrix<double, 10, 10> Matrix10d;
+
+  /**
+   * @brief Ellipsoid in the form of eq. 15 of Renaudin, (x^T Q x + ub^T x + k = 0).
+   */
+  struct Ellipsoid
+  {
+    Eigen::Matrix3d Q;      ///< Quadratic term.
+    Eigen::Vector3d ub;     ///< Linear term.
+    double k;               ///< Constant term.
+    Eigen::Vector3d center; ///< Center of the ellipsoid, from eq. 21 of Renaudin.
+  };
+
+  /// Number of measurements each RANSAC hypothesis is fit to.
+  static constexpr size_t RANSAC_SAMPLE_SIZE = 9;
+  /// Probability of drawing at least one outlier free sample that RANSAC stops early with.
+  static constexpr double RANSAC_CONFIDENCE = 0.99;
+  /// Largest residual of a fit that is still good enough to bin measurement directions with.
+  static constexpr double COVERAGE_FIT_RESIDUAL = 0.1;
+
+  /**
+   * @brief Result of calibrating one recorded capture in batch mode.
+   */
+  struct BatchResult
+  {
+    std::string file;        ///< Recorded capture.
+    std::string output;      ///< Parameter file the calibration was written to.
+    bool success;            ///< Flag for whether the capture could be read and fit.
+    size_t num_measurements; ///< Number of distinct measurements in the capture.
+    size_t num_inliers;      ///< Number of measurements within inlier_thresh_ of the fit.
+    double residual;         ///< Residual of the fit over the inliers, see fitResidual.
+    double coverage;         ///< Fraction of the orientation bins covered by the inliers.
+    Eigen::Matrix3d A;       ///< Soft iron calibration matrix.
+    Eigen::Vector3d b;       ///< Hard iron calibration bias.
+  };
+
+  /**
+   * @brief Calibrate recorded captures without connecting to a vehicle.
+   *
+   * The captures are fit in parallel. A parameter file that can be loaded with the
+   * "param_load_from_file" service is written for each capture, and the quality of every fit is
+   * written to a summary file.
+   */
+  void run_batch();
+
+  /**
+   * @brief Read and fit one recorded capture.
+   *
+   * @param file ROS bag, or raw MAVLink log.
+   * @param result Calibration and quality of the fit.
+   * @return False if the capture could not be read or no ellipsoid could be fit to it.
+   */
+  bool calibrate_capture(const std::string & file, BatchResult & result);
+
+  /**
+   * @brief Read the magnetometer measurements from a recorded capture.
+   *
+   * Directories and files ending in .db3 or .mcap are read as ROS bags, from the "batch_topic"
+   * topic. Anything else is read as a raw MAVLink byte stream, using its SMALL_MAG messages.
+   *
+   * @param file Recorded capture.
+   * @param measurements Distinct consecutive measurements in the capture.
+   * @return False if the capture could not be read.
+   */
+  bool load_capture(const std::string & file, EigenSTL::vector_Vector3d & measurements) const;
+
+  /**
+   * @brief Write a calibration as a parameter file, with the quality of the fit as comments.
+   */
+  static bool writeParamFile(const BatchResult & result);
+
   /**
    * @brief Begin the magnetometer calibration routine.
    */
@@ -86,15 +166,29 @@ private:
 
   /**
    * @brief Calculate calibration constants from collected data.
+   *
+   * Uses RANSAC on the stored measurements, or the scatter matrix in online mode.
+   *
+   * @return False if no ellipsoid could be fit to the data.
+   */
+  bool do_mag_calibration();
+
+  /**
+   * @brief Callback function for the fit timer.
+   *
+   * Fits an ellipsoid to the scatter matrix accumulated so far, and publishes the provisional
+   * calibration and coverage on the "mag_calibration" topic. Ends the capture once the coverage
+   * and residual targets are both met.
    */
-  void do_mag_calibration();
+  void fit_timer_callback();
 
   /**
    * @brief Callback function for "magnetometer" ROS topic subscription.
    *
    * This function is called everytime CalibrateMag receives magnetometer data from rosflight_io over
-   * the "magnetometer" topic. It collects magnetometer data until the calibration time has completed,
-   * printing status messages in the process.
+   * the "magnetometer" topic. It collects magnetometer data until the calibration ends, printing
+   * status messages in the process. Once a provisional fit exists, a measurement is only kept if
+   * the bin of its calibrated direction is not full yet.
    *
    * @param mag ROS MagneticField message object.
    */
@@ -119,59 +213,103 @@ private:
   double a32() const { return A_(2, 1); }
   /// Get the value from A(3,3) (index starts at 1).
   double a33() const { return A_(2, 2); }
-  /// Get the x value from the b matrix.
-  double bx() const { return b_(0, 0); }
-  /// Get the y value from the b matrix.
-  double by() const { return b_(1, 0); }
-  /// Get the z value from the b matrix.
-  double bz() const { return b_(2, 0); }
+  /// Get the x value from the b vector.
+  double bx() const { return b_(0); }
+  /// Get the y value from the b vector.
+  double by() const { return b_(1); }
+  /// Get the z value from the b vector.
+  double bz() const { return b_(2); }
+
+  /// Names of the calibration parameters: the soft iron matrix by row, then the hard iron bias.
+  inline static const std::vector<std::string> CALIBRATION_PARAMS = {
+    "MAG_A11_COMP", "MAG_A12_COMP", "MAG_A13_COMP", "MAG_A21_COMP", "MAG_A22_COMP", "MAG_A23_COMP",
+    "MAG_A31_COMP", "MAG_A32_COMP", "MAG_A33_COMP", "MAG_X_BIAS", "MAG_Y_BIAS", "MAG_Z_BIAS"};
 
   /**
-   * @brief Set a ROSflight parameter.
-   * @param name Name of parameter to set.
-   * @param value Value to set parameter to.
-   * @return Success of parameter setting.
+   * @brief Set several ROSflight parameters in one request.
+   *
+   * The parameters are sent to the firmware together, and this returns once the firmware has
+   * confirmed all of them.
+   *
+   * @param names Names of parameters to set.
+   * @param values Values to set parameters to.
+   * @return True if every parameter exists and was confirmed by the firmware.
    */
-  bool set_param(std::string name, double value);
+  bool set_params(const std::vector<std::string> & names, const std::vector<double> & values);
 
   /// "magnetometer" ROS topic subscription.
   message_filters::Subscriber<sensor_msgs::msg::MagneticField> mag_subscriber_;
 
-  /// "param_set" ROS service client, used for setting ROSflight params.
-  rclcpp::Client<rosflight_msgs::srv::ParamSet>::SharedPtr param_set_client_;
+  /// "param_set_many" ROS service client, used for setting ROSflight params.
+  rclcpp::Client<rosflight_msgs::srv::ParamSetMany>::SharedPtr param_set_client_;
 
-  Eigen::MatrixXd A_; ///< Matrix used in calibration constant calculation.
-  Eigen::MatrixXd b_; ///< Matrix used in calibration constant calculation.
+  Eigen::Matrix3d A_; ///< Soft iron calibration matrix.
+  Eigen::Vector3d b_; ///< Hard iron calibration bias.
 
   double reference_field_strength_; ///< The strength of earth's magnetic field at your location.
 
   bool calibrating_;         ///< Flag for whether a calibration is currently in progress.
   bool first_time_;          ///< Flag for waiting for first measurement for calibration.
-  double calibration_time_;  ///< Seconds to record data for calibration.
+  double calibration_time_;  ///< Maximum seconds to record data for calibration.
   double start_time_;        ///< Timestamp of first calibration measurement.
-  int ransac_iters_;         ///< Number of ransac iterations to fit ellipsoid to mag measurements.
-  int measurement_skip_;     ///< Number of measurements to skip at the start of calibration.
-  int measurement_throttle_; ///< Stores the number measurements already skipped.
+  int ransac_iters_;         ///< Max number of ransac iterations to fit ellipsoid to measurements.
+  int ransac_threads_;       ///< Number of threads to run ransac on, 0 to use all cores.
   double inlier_thresh_;     ///< Threshold to consider a measurement an inlier in ellipsoidRANSAC.
   Eigen::Vector3d
     measurement_prev_; ///< Stores previous measurement to ensure no duplicate measurements.
-  EigenSTL::vector_Vector3d measurements_; ///< Stores all measurements.
+  EigenSTL::vector_Vector3d measurements_; ///< Stores all measurements, unless fitting online.
+
+  bool online_fit_;      ///< Fit the scatter matrix at the end instead of storing measurements.
+  Matrix10d scatter_;    ///< Scatter matrix of the measurements.
+  size_t scatter_count_; ///< Number of measurements in the scatter matrix.
+  double fit_residual_;  ///< Residual of the latest provisional fit, negative before the first fit.
+
+  SphereCoverage coverage_;    ///< Bins of the calibrated measurement directions.
+  bool coverage_fit_;          ///< Flag for whether a fit is good enough to bin directions with.
+  Eigen::Matrix3d coverage_A_; ///< Soft iron matrix of the fit directions are binned with.
+  Eigen::Vector3d coverage_b_; ///< Hard iron bias of the fit directions are binned with.
+  double coverage_target_;     ///< Fraction of the bins to cover before the capture can end.
+  double residual_target_;     ///< Fit residual to reach before the capture can end.
+
+  std::vector<std::string> batch_files_; ///< Recorded captures to calibrate in batch mode.
+  std::string batch_topic_;              ///< Magnetometer topic in recorded ROS bags.
+  std::string output_dir_;               ///< Directory batch mode writes its results to.
+  int batch_threads_;                    ///< Number of captures to fit at once, 0 for all cores.
+
+  /// "mag_calibration" ROS topic publisher, for provisional calibrations and coverage.
+  rclcpp::Publisher<rosflight_msgs::msg::MagCalibration>::SharedPtr calibration_pub_;
+  /// ROS timer for the provisional fit.
+  rclcpp::TimerBase::SharedPtr fit_timer_;
 
   /**
    * @brief Function to perform RANSAC on ellipsoid data.
+   *
+   * Hypotheses are fit to random samples and scored in parallel, with a random number generator
+   * per thread. The iterations stop early once enough have been run to find an outlier free sample
+   * with RANSAC_CONFIDENCE, given the inlier ratio of the best hypothesis so far.
+   *
    * @param meas Vector of stored measurement data.
-   * @param iters Number of iterations to run RANSAC on data.
+   * @param iters Max number of iterations to run RANSAC on data.
    * @param inlier_thresh Distance threshold for which measurements are included in calibration.
    * @return Ellipsoid fit to measurements, for use in calibration.
    */
-  Eigen::MatrixXd ellipsoidRANSAC(EigenSTL::vector_Vector3d meas, int iters, double inlier_thresh);
+  Vector10d ellipsoidRANSAC(const EigenSTL::vector_Vector3d & meas, int iters,
+                            double inlier_thresh);
+
+  /// Number of RANSAC iterations needed to draw an outlier free sample with RANSAC_CONFIDENCE.
+  static int ransacIterations(double inlier_ratio);
+
+  /// Convert ellipsoid coefficients to matrix form, returns false if they are not an ellipsoid.
+  static bool toEllipsoid(const Vector10d & u, Ellipsoid & ellipsoid);
 
   /// Function to vector from ellipsoid center to surface along input vector
-  static Eigen::Vector3d intersect(const Eigen::Vector3d & r_m, const Eigen::Vector3d & r_e,
-                                   const Eigen::MatrixXd & Q, const Eigen::MatrixXd & ub, double k);
+  static Eigen::Vector3d intersect(const Eigen::Vector3d & r_m, const Ellipsoid & ellipsoid);
+
+  /// Signed distance of a measurement from the ellipsoid surface, along the surface normal.
+  static double surfaceDistance(const Eigen::Vector3d & r_m, const Ellipsoid & ellipsoid);
 
-  /// Sort eigenvalues and eigenvectors output from Eigen library.
-  static void eigSort(Eigen::MatrixXd & w, Eigen::MatrixXd & v);
+  /// Add a measurement to a scatter matrix, as a column of the D matrix of eq. 6 of Li.
+  static void addToScatter(const Eigen::Vector3d & meas, Matrix10d & DDt);
 
   /**
    * @brief Gets ellipsoid parameters via least squares fitting.
@@ -179,8 +317,26 @@ private:
    * This function gets ellipsoid parameters via least squares on ellipsoidal data
    * according to the paper: Li, Qingde, and John G. Griffiths. "Least squares ellipsoid
    * specific fitting." Geometric modeling and processing, 2004. proceedings. IEEE, 2004.
+   *
+   * @param DDt Scatter matrix of the measurements, see addToScatter.
+   * @return Ellipsoid coefficients, all NaN if the eigensystem could not be solved.
+   */
+  static Vector10d ellipsoidLS(const Matrix10d & DDt);
+
+  /**
+   * @brief RMS relative error of the calibrated field strength of a fit.
+   *
+   * Scaled so the ellipsoid equation is (calibrated field / reference field)^2 - 1, the algebraic
+   * residual of each measurement is about twice its relative field strength error. The sum of the
+   * squared residuals is u^T D D^T u, so this only needs the scatter matrix.
+   *
+   * @param u Ellipsoid coefficients.
+   * @param ellipsoid The same ellipsoid, in matrix form.
+   * @param DDt Scatter matrix of the measurements.
+   * @param count Number of measurements in the scatter matrix.
    */
-  static Eigen::MatrixXd ellipsoidLS(EigenSTL::vector_Vector3d meas);
+  static double fitResidual(const Vector10d & u, const Ellipsoid & ellipsoid, const Matrix10d & DDt,
+                            size_t count);
 
   /**
    * @brief Compute magnetometer calibration parameters.
@@ -189,7 +345,7 @@ private:
    * paper: Renaudin, Valérie, Muhammad Haris Afzal, and Gérard Lachapelle. "Complete triaxis
    * magnetometer calibration in the magnetic domain." Journal of sensors 2010 (2010).
    */
-  void magCal(Eigen::MatrixXd u, Eigen::MatrixXd & A, Eigen::MatrixXd & bb) const;
+  void magCal(const Vector10d & u, Eigen::Matrix3d & A, Eigen::Vector3d & bb) const;
 };
 
 } // namespace rosflight_io
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file io_thread_pool.h
+ * \author agent <agent@local>
+ */
+
+#ifndef MAVROSFLIGHT_IO_THREAD_POOL_H
+#define MAVROSFLIGHT_IO_THREAD_POOL_H
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace mavrosflight
+{
+/**
+ * \brief A boost io service run by a pool of threads, which can be shared by several links
+ *
+ * By default each MavlinkComm runs its own io service on its own thread. When one process serves
+ * many flight controllers, the links can share a pool instead, so the io and message handling of
+ * all links is spread over a fixed number of threads.
+ */
+class IoThreadPool
+{
+public:
+  /**
+   * \brief Starts the threads of the pool
+   * \param num_threads Number of threads running the io service
+   */
+  explicit IoThreadPool(size_t num_threads);
+
+  /**
+   * \brief Stops the io service and joins the threads of the pool
+   */
+  ~IoThreadPool();
+
+  IoThreadPool(const IoThreadPool &) = delete;
+  IoThreadPool & operator=(const IoThreadPool &) = delete;
+
+  /**
+   * \brief Get the io service run by the pool
+   */
+  boost::asio::io_service & io_service() { return io_service_; }
+
+  /**
+   * \brief Get the process-wide shared pool, creating it if it does not exist yet
+   * \param num_threads Number of threads, only used if the pool is created by this call
+   * \return Shared pointer to the pool, which lives as long as anyone holds a pointer to it
+   */
+  static std::shared_ptr<IoThreadPool> get_shared(size_t num_threads);
+
+private:
+  boost::asio::io_service io_service_;                  //!< io service run by the pool
+  std::unique_ptr<boost::asio::io_service::work> work_; //!< keeps the threads running when idle
+  boost::thread_group threads_;                         //!< threads running the io service
+};
+
+} // namespace mavrosflight
+
+#endif // MAVROSFLIGHT_IO_THREAD_POOL_H
@@ -39,6 +39,12 @@
 #ifndef MAVROSFLIGHT_MAVLINK_BRIDGE_H
 #define MAVROSFLIGHT_MAVLINK_BRIDGE_H
 
+// The MAVLink parser keeps its state in a static buffer per channel, and every link opened in the
+// process gets its own channel (see MavlinkComm::open), so reserve enough channels for many links
+#ifndef MAVLINK_COMM_NUM_BUFFERS
+#define MAVLINK_COMM_NUM_BUFFERS 64
+#endif
+
 #include <rosflight_io/mavlink/v1.0/rosflight/mavlink.h>
 
 #endif // MAVROSFLIGHT_MAVLINK_BRIDGE_H
@@ -37,16 +37,22 @@
 #ifndef MAVROSFLIGHT_MAVLINK_COMM_H
 #define MAVROSFLIGHT_MAVLINK_COMM_H
 
+#include <rosflight_io/mavrosflight/io_thread_pool.hpp>
 #include <rosflight_io/mavrosflight/mavlink_bridge.hpp>
 #include <rosflight_io/mavrosflight/mavlink_listener_interface.hpp>
+#include <rosflight_io/mavrosflight/mavlink_write_listener_interface.hpp>
 
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
 #include <boost/thread.hpp>
 
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -58,11 +64,10 @@ class MavlinkComm
 {
 public:
   /**
-   * \brief Instantiates the class and begins communication on the specified serial port
-   * \param port Name of the serial port (e.g. "/dev/ttyUSB0")
-   * \param baud_rate Serial communication baud rate
+   * \brief Instantiates the class
+   * \param io_pool Thread pool to run the io on, or nullptr to run it on a dedicated thread
    */
-  MavlinkComm();
+  explicit MavlinkComm(std::shared_ptr<IoThreadPool> io_pool = nullptr);
 
   /**
    * \brief Stops communication and closes the serial port before the object is destroyed
@@ -71,6 +76,9 @@ public:
 
   /**
    * \brief Opens the port and begins communication
+   *
+   * Each open link gets its own MAVLink parser channel. Throws a SerialException if the port can
+   * not be opened, or if all MAVLINK_COMM_NUM_BUFFERS channels are in use.
    */
   void open();
 
@@ -91,6 +99,18 @@ public:
    */
   void unregister_mavlink_listener(MavlinkListenerInterface * listener);
 
+  /**
+   * \brief Register a listener for completed writes of outgoing mavlink messages
+   * \param listener Pointer to an object implementing the MavlinkWriteListenerInterface interface
+   */
+  void register_write_listener(MavlinkWriteListenerInterface * listener);
+
+  /**
+   * \brief Unregister a listener for completed writes of outgoing mavlink messages
+   * \param listener Pointer to an object implementing the MavlinkWriteListenerInterface interface
+   */
+  void unregister_write_listener(MavlinkWriteListenerInterface * listener);
+
   /**
    * \brief Send a mavlink message
    * \param msg The message to send
@@ -108,7 +128,9 @@ protected:
   do_async_write(const boost::asio::const_buffers_1 & buffer,
                  boost::function<void(const boost::system::error_code &, size_t)> handler) = 0;
 
-  boost::asio::io_service io_service_; //!< boost io service provider
+  std::shared_ptr<IoThreadPool> io_pool_;                  //!< shared pool, if not using own thread
+  std::unique_ptr<boost::asio::io_service> own_io_service_; //!< io service, if not using a pool
+  boost::asio::io_service & io_service_;                    //!< boost io service provider
 
 private:
   //===========================================================================
@@ -123,15 +145,19 @@ private:
     uint8_t data[MAVLINK_MAX_PACKET_LEN] = {0};
     size_t len;
     size_t pos;
+    uint32_t msgid;                                     //!< id of the buffered message
+    std::chrono::steady_clock::time_point enqueue_time; //!< time the message was queued
 
     WriteBuffer()
         : len(0)
         , pos(0)
+        , msgid(0)
     {}
 
     WriteBuffer(const uint8_t * buf, uint16_t len)
         : len(len)
         , pos(0)
+        , msgid(0)
     {
       assert(len <= MAVLINK_MAX_PACKET_LEN); //! \todo Do something less catastrophic here
       memcpy(data, buf, len);
@@ -147,10 +173,56 @@ private:
    */
   typedef boost::lock_guard<boost::recursive_mutex> mutex_lock;
 
+  /**
+   * \brief Marks the end of an asynchronous operation when it goes out of scope
+   *
+   * With a shared io service, handlers can still be queued after the port is closed, so close()
+   * waits for all operations to finish before the object can be destroyed.
+   */
+  class OperationGuard
+  {
+  public:
+    explicit OperationGuard(MavlinkComm * comm)
+        : comm_(comm)
+    {}
+    ~OperationGuard() { comm_->end_operation(); }
+
+  private:
+    MavlinkComm * comm_;
+  };
+
   //===========================================================================
   // methods
   //===========================================================================
 
+  /**
+   * \brief Record the start of an asynchronous operation
+   */
+  void begin_operation();
+
+  /**
+   * \brief Record the end of an asynchronous operation
+   */
+  void end_operation();
+
+  /**
+   * \brief Close the port after a read or write error, from within an io handler
+   * \param error Error code
+   */
+  void handle_io_error(const boost::system::error_code & error);
+
+  /**
+   * \brief Claim a free MAVLink parser channel
+   * \return The channel, or -1 if all channels are in use
+   */
+  static int acquire_channel();
+
+  /**
+   * \brief Return a MAVLink parser channel to the pool
+   * \param channel The channel
+   */
+  static void release_channel(int channel);
+
   /**
    * \brief Initiate an asynchronous read operation
    */
@@ -180,11 +252,18 @@ private:
   // member variables
   //===========================================================================
 
-  std::vector<MavlinkListenerInterface *> listeners_; //!< listeners for mavlink messages
+  std::vector<MavlinkListenerInterface *> listeners_;            //!< listeners for mavlink messages
+  std::vector<MavlinkWriteListenerInterface *> write_listeners_; //!< listeners for completed writes
 
   boost::thread io_thread_;      //!< thread on which the io service runs
   boost::recursive_mutex mutex_; //!< mutex for threadsafe operation
 
+  std::mutex pending_mutex_;           //!< mutex for the count of pending operations
+  std::condition_variable pending_cv_; //!< signaled when the last pending operation finishes
+  size_t pending_operations_;          //!< number of asynchronous operations not yet finished
+
+  int channel_; //!< MAVLink parser channel used by this link, or -1 if not open
+
   uint8_t read_buf_raw_[MAVLINK_SERIAL_READ_BUF_SIZE];
 
   mavlink_message_t msg_in_;
@@ -42,6 +42,7 @@
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
 
+#include <memory>
 #include <string>
 
 namespace mavrosflight
@@ -53,8 +54,9 @@ public:
    * \brief Instantiates the class and begins communication on the specified serial port
    * \param port Name of the serial port (e.g. "/dev/ttyUSB0")
    * \param baud_rate Serial communication baud rate
+   * \param io_pool Thread pool to run the io on, or nullptr to run it on a dedicated thread
    */
-  MavlinkSerial(std::string port, int baud_rate);
+  MavlinkSerial(std::string port, int baud_rate, std::shared_ptr<IoThreadPool> io_pool = nullptr);
 
   /**
    * \brief Stops communication and closes the serial port before the object is destroyed
@@ -42,6 +42,7 @@
 #include <boost/asio.hpp>
 #include <boost/function.hpp>
 
+#include <memory>
 #include <string>
 
 namespace mavrosflight
@@ -55,9 +56,10 @@ public:
    * \param bind_port Port number for this node
    * \param remote_host Host where the other node is running
    * \param remote_port Port number for the other node
+   * \param io_pool Thread pool to run the io on, or nullptr to run it on a dedicated thread
    */
   MavlinkUDP(std::string bind_host, uint16_t bind_port, std::string remote_host,
-             uint16_t remote_port);
+             uint16_t remote_port, std::shared_ptr<IoThreadPool> io_pool = nullptr);
 
   /**
    * \brief Stops communication and closes the serial port before the object is destroyed
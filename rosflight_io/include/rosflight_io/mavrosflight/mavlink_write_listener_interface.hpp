@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file mavlink_write_listener_interface.h
+ * \author agent <agent@local>
+ */
+
+#ifndef MAVROSFLIGHT_MAVLINK_WRITE_LISTENER_INTERFACE_H
+#define MAVROSFLIGHT_MAVLINK_WRITE_LISTENER_INTERFACE_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace mavrosflight
+{
+/**
+ * \brief Describes an interface classes can implement to be notified when outgoing mavlink messages
+ * have been written to the port
+ */
+class MavlinkWriteListenerInterface
+{
+public:
+  /**
+   * \brief Called from the io thread when the last byte of a message has been handed to the port
+   * \param msgid The id of the message that was written
+   * \param enqueue_time The time the message was passed to MavlinkComm::send_message
+   * \param write_time The time the write completed
+   */
+  virtual void on_message_written(uint32_t msgid,
+                                  std::chrono::steady_clock::time_point enqueue_time,
+                                  std::chrono::steady_clock::time_point write_time) = 0;
+};
+
+} // namespace mavrosflight
+
+#endif // MAVROSFLIGHT_MAVLINK_WRITE_LISTENER_INTERFACE_H
@@ -56,16 +56,41 @@ public:
   MAV_PARAM_TYPE getType() const;
   double getValue() const;
 
-  void requestSet(double value, mavlink_message_t * msg);
+  /**
+   * \brief Get the value as it is sent over MAVLink, with integer types bit-cast into a float
+   */
+  float getRawValue() const;
+
+  /**
+   * \brief Pack a PARAM_SET message for a new value
+   * \param value The requested value
+   * \param msg Filled with the PARAM_SET message if one is needed
+   * \return False if the parameter already has this value and no set is in progress
+   */
+  bool requestSet(double value, mavlink_message_t * msg);
+
+  /**
+   * \brief True if a value, once cast to the parameter type, differs from the current value
+   */
+  bool differsFrom(double value) const;
+
+  /**
+   * \brief Get a value cast to the parameter type, as the autopilot would store it
+   */
+  double getCastValue(double value) const;
+
   bool handleUpdate(const mavlink_param_value_t & msg);
 
+  /**
+   * \brief True if a set was requested and the firmware has not yet echoed the requested value
+   */
+  bool isSetInProgress() const;
+
 private:
   void init(std::string name, int index, MAV_PARAM_TYPE type, float raw_value);
 
   void setFromRawValue(float raw_value);
-  float getRawValue();
-  float getRawValue(double value);
-  double getCastValue(double value);
+  float getRawValue(double value) const;
 
   template<typename T>
   double fromRawValue(float value)
@@ -76,7 +101,7 @@ private:
   }
 
   template<typename T>
-  float toRawValue(double value)
+  float toRawValue(double value) const
   {
     T t_value = static_cast<T>(value);
     float result = 0.0f;
@@ -85,7 +110,7 @@ private:
   }
 
   template<typename T>
-  double toCastValue(double value)
+  double toCastValue(double value) const
   {
     return static_cast<double>(static_cast<T>(value));
   }
@@ -66,6 +66,29 @@ public:
    * \param unsaved_changes True if there are parameters that have been set but not saved on the autopilot
    */
   virtual void on_params_saved_change(bool unsaved_changes) = 0;
+
+  /**
+   * \brief Called when a parameter set is requested, before any result of it is reported
+   *
+   * Called on the thread that requested the set, with the parameter lock held. Results reported
+   * before this call belong to sets of the same parameter that were requested earlier.
+   *
+   * \param name The name of the parameter
+   * \param value The requested value, cast to the type of the parameter
+   */
+  virtual void on_param_set_requested(std::string name, double value) {}
+
+  /**
+   * \brief Called when a parameter set request is confirmed by the autopilot or given up on
+   *
+   * Also called right away if the parameter already has the requested value, so every accepted
+   * set request is followed by a result.
+   *
+   * \param name The name of the parameter
+   * \param success True if the autopilot echoed the requested value
+   * \param value The value of the parameter reported by the autopilot
+   */
+  virtual void on_param_set_result(std::string name, bool success, double value) {}
 };
 
 } // namespace mavrosflight
@@ -45,17 +45,71 @@
 
 #include <rclcpp/rclcpp.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace mavrosflight
 {
+/**
+ * \brief Keeps a copy of the firmware parameters and handles getting and setting them
+ *
+ * The parameters are downloaded by first asking the firmware to stream the whole list. Indices
+ * skipped in the stream are requested individually, and once the stream stalls all remaining
+ * indices are requested with a sliding window of PARAM_REQUEST_READ messages in flight. Requests
+ * are retransmitted after a timeout derived from the measured round trip time, or immediately
+ * once several requests sent after them have been answered.
+ *
+ * Parameter sets are uploaded the same way, with a window of PARAM_SET messages in flight. A set
+ * is confirmed once the firmware echoes the requested value, and is retried on timeout or when
+ * the echo carries a different value.
+ *
+ * If a cache directory is set, the parameters are also kept on disk, keyed by vehicle and firmware
+ * version. On connect, a handful of cached parameters are spot checked against the firmware; if
+ * they match, the whole cache is used right away and every parameter is verified in the
+ * background, otherwise the parameters are downloaded as usual.
+ *
+ * Parameters are stored by their MAVLink index, with a sorted table for looking them up by name.
+ * Every change of a parameter value is recorded in a bounded journal, so clients can ask for what
+ * changed since they last checked instead of reading every parameter.
+ */
 class ParamManager : public MavlinkListenerInterface
 {
 public:
+  /**
+   * \brief A change of a parameter value, as recorded in the change journal
+   */
+  struct ParamChange
+  {
+    uint64_t sequence; //!< sequence number of the change, starting at 1
+    int index;         //!< index of the parameter
+    std::string name;  //!< name of the parameter
+    double old_value;  //!< value before the change
+    double new_value;  //!< value after the change
+    rclcpp::Time time; //!< time the change was received
+  };
+
+  /**
+   * \brief Differences between the onboard parameters and a parameter file
+   */
+  struct ParamFileDiff
+  {
+    std::vector<std::string> changed;         //!< names of the parameters whose values differ
+    std::vector<double> onboard_values;       //!< onboard value of each changed parameter
+    std::vector<double> file_values;          //!< file value of each changed parameter
+    std::vector<std::string> type_mismatches; //!< parameters whose type differs from the file
+    std::vector<std::string> missing;         //!< parameters in the file that are not onboard
+    size_t num_entries;                       //!< number of parameters in the file
+    size_t num_sent;                          //!< number of PARAM_SET messages sent
+  };
+
   ParamManager(MavlinkComm * comm, rclcpp::Node * node);
   ~ParamManager();
 
@@ -71,39 +125,296 @@ public:
   void unregister_param_listener(ParamListenerInterface * listener);
 
   bool save_to_file(const std::string & filename);
+
+  /**
+   * \brief Upload the parameters in a file that differ from the onboard values
+   * \return False if the file could not be read
+   */
   bool load_from_file(const std::string & filename);
 
+  /**
+   * \brief Compare the onboard parameters to a parameter file
+   * \param filename Parameter file, as written by save_to_file()
+   * \param upload If true, also set the parameters whose values differ
+   * \param diff Filled with the differences
+   * \return False if the file could not be read
+   */
+  bool diff_file(const std::string & filename, bool upload, ParamFileDiff * diff);
+
   int get_num_params() const;
   int get_params_received() const;
   bool got_all_params() const;
 
+  /**
+   * \brief Start downloading the parameters, or resume a download that is missing parameters
+   *
+   * The download keeps retrying on its own until all parameters are received.
+   */
   void request_params();
 
+  /**
+   * \brief Enable the on-disk parameter cache, must be called before request_params()
+   * \param directory Directory the cache files are kept in
+   * \param name Name of this vehicle, to keep the caches of different vehicles apart
+   */
+  void enable_cache(const std::string & directory, const std::string & name);
+
+  /**
+   * \brief Set the identity of the connected firmware, which the parameter cache is keyed by
+   *
+   * The MAVLink system and component ids tell apart vehicles that are served by nodes with the
+   * same name, as long as each vehicle has its own system id.
+   *
+   * \param version Firmware version string
+   * \param sysid MAVLink system id of the flight controller
+   * \param compid MAVLink component id of the flight controller
+   */
+  void set_firmware_version(const std::string & version, uint8_t sysid, uint8_t compid);
+
+  /**
+   * \brief Get the parameter changes recorded after a given sequence number
+   * \param sequence Sequence number of the last change the caller has seen, 0 for all changes
+   * \param changes Filled with the newer changes, oldest first
+   * \param latest Set to the sequence number of the latest change
+   * \return False if older changes were already dropped from the journal, so some are missing
+   */
+  bool get_changes_since(uint64_t sequence, std::vector<ParamChange> * changes,
+                         uint64_t * latest);
+
 private:
+  /**
+   * \brief Progress of using the parameter cache for the current download
+   */
+  enum class CacheState
+  {
+    UNUSED,              //!< not using the cache, either disabled or found to be out of date
+    WAITING_FOR_VERSION, //!< cache enabled, waiting for the firmware version to find the file
+    SPOT_CHECK,          //!< checking a few cached parameters against the firmware
+    VERIFYING,           //!< cache in use, verifying the remaining parameters in the background
+  };
+
+  /**
+   * \brief An outstanding PARAM_REQUEST_READ
+   */
+  struct ParamRequest
+  {
+    std::chrono::steady_clock::time_point send_time; //!< time the request was last sent
+    int retries;                                     //!< number of retransmissions
+    int later_replies;                               //!< later requests answered since last sent
+  };
+
+  /**
+   * \brief A requested parameter set that has not been confirmed yet
+   */
+  struct ParamSet
+  {
+    double value;                                    //!< requested value
+    mavlink_message_t msg;                           //!< PARAM_SET message to (re)send
+    bool in_flight;                                  //!< false while waiting in the queue
+    std::chrono::steady_clock::time_point send_time; //!< time the message was last sent
+    int retries;                                     //!< number of retransmissions
+    int superseded;                                  //!< replaced sends that may still be echoed
+  };
+
+  //! max number of PARAM_REQUEST_READ messages in flight
+  static constexpr size_t DOWNLOAD_WINDOW = 8;
+  //! number of replies to later requests after which a request is retransmitted
+  static constexpr int FAST_RETRANSMIT_THRESHOLD = 3;
+  //! time between checks for timed out requests
+  static constexpr std::chrono::milliseconds DOWNLOAD_PERIOD{10};
+  //! retransmission timeout before the round trip time has been measured
+  static constexpr std::chrono::milliseconds INITIAL_RTO{250};
+  //! lower bound on the retransmission timeout
+  static constexpr std::chrono::milliseconds MIN_RTO{20};
+  //! upper bound on the retransmission timeout, including backoff
+  static constexpr std::chrono::milliseconds MAX_RTO{2000};
+  //! shortest pause in the parameter stream that is treated as the end of the stream
+  static constexpr std::chrono::milliseconds MIN_STREAM_STALL{100};
+  //! time to wait for the firmware version before downloading without the cache
+  static constexpr std::chrono::milliseconds CACHE_VERSION_TIMEOUT{1000};
+  //! number of cached parameters checked against the firmware before the cache is used
+  static constexpr size_t SPOT_CHECK_COUNT = 8;
+  //! time between background verification requests
+  static constexpr std::chrono::milliseconds VERIFY_PERIOD{20};
+  //! max number of PARAM_SET messages in flight
+  static constexpr size_t UPLOAD_WINDOW = 8;
+  //! number of retransmissions before a set is reported as failed
+  static constexpr int MAX_SET_RETRIES = 5;
+  //! number of changes kept in the change journal
+  static constexpr size_t CHANGE_JOURNAL_SIZE = 1000;
+
   void request_param_list();
   void request_param(int index);
 
+  /**
+   * \brief Start downloading by asking the firmware to stream the full list
+   */
+  void start_list_download(std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief Load the cache for the current firmware and start spot checking it
+   */
+  void start_cache_check(std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief Path of the cache file for the current vehicle and firmware, or "" if not known yet
+   */
+  std::string cache_file() const;
+
+  /**
+   * \brief Load a cache file into cache_
+   * \return False if the file is missing, for a different firmware, or corrupt
+   */
+  bool load_cache(const std::string & filename);
+
+  /**
+   * \brief Write the current parameters to a cache file
+   * \param filename Path of the cache file, nothing is written if empty
+   * \param version Firmware version the parameters belong to
+   */
+  void save_cache(const std::string & filename, const std::string & version);
+
+  /**
+   * \brief True if a PARAM_VALUE message matches the cached parameter at its index
+   */
+  bool matches_cache(const mavlink_param_value_t & param) const;
+
+  /**
+   * \brief FNV-1a hash of a complete set of parameters, ordered by index
+   */
+  static uint64_t hash_params(const std::vector<Param> & params);
+
+  void download_timer_callback();
+
+  /**
+   * \brief Send requests for pending indices until the window is full
+   */
+  void fill_download_window(std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief (Re)send the request for a parameter index and record it as in flight
+   */
+  void send_param_request(int index, std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief Queue requests for all missing indices that are not already in flight
+   */
+  void queue_missing_params();
+
+  /**
+   * \brief Update the round trip time estimate and retransmission timeout with a new measurement
+   */
+  void update_rtt(std::chrono::steady_clock::duration rtt);
+
+  /**
+   * \brief Retransmission timeout after the given number of retries
+   */
+  std::chrono::steady_clock::duration retransmit_timeout(int retries) const;
+
+  /**
+   * \brief Send queued sets until the upload window is full
+   */
+  void fill_upload_window(std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief Retransmit an in-flight set, or report it as failed once it is out of retries
+   * \return False if the set was given up on and removed
+   */
+  bool retry_set(std::map<int, ParamSet>::iterator set,
+                 std::chrono::steady_clock::time_point now);
+
+  /**
+   * \brief Report the result of a set and remove it from the upload
+   */
+  void finish_set(std::map<int, ParamSet>::iterator set, bool success);
+
   void handle_param_value_msg(const mavlink_message_t & msg);
   void handle_command_ack_msg(const mavlink_message_t & msg);
 
-  bool is_param_id(const std::string & name);
+  /**
+   * \brief Index of the parameter with the given name, or -1 if there is none
+   */
+  int find_param(const std::string & name) const;
+
+  /**
+   * \brief True if the parameter at the given index has been received
+   */
+  bool has_param(int index) const;
+
+  /**
+   * \brief Store a parameter at its index and add it to the name table
+   */
+  void add_param(const Param & param);
+
+  /**
+   * \brief Null terminated name of a PARAM_VALUE message
+   */
+  static std::string param_name(const mavlink_param_value_t & param);
+
+  /**
+   * \brief Append a change of the parameter at the given index to the change journal
+   */
+  void record_change(int index, double old_value);
 
   std::vector<ParamListenerInterface *> listeners_;
 
   rclcpp::Node * const node_;
   MavlinkComm * const comm_;
-  std::map<std::string, Param> params_;
+
+  std::recursive_mutex params_mutex_;                    //!< protects params_ and the upload state
+  std::vector<Param> params_;                            //!< parameters, by index
+  std::vector<std::pair<std::string, int>> param_names_; //!< name to index, sorted by name
+  std::deque<ParamChange> change_journal_;               //!< most recent changes, oldest first
+  uint64_t latest_change_;                               //!< sequence number of the latest change
 
   bool unsaved_changes_;
   bool write_request_in_progress_;
 
+  mutable std::mutex download_mutex_; //!< protects the download state, shared by io and ROS threads
+
   bool first_param_received_;
   int num_params_;
   int received_count_;
-  bool * received_;
+  std::vector<bool> received_;
   bool got_all_params_;
 
-  std::deque<mavlink_message_t> param_set_queue_;
+  rclcpp::TimerBase::SharedPtr download_timer_;
+  bool list_streaming_;                   //!< true while the firmware streams the full list
+  int list_retries_;                      //!< number of times the list was requested again
+  int highest_index_;                     //!< highest index received from the stream so far
+  std::map<int, ParamRequest> in_flight_; //!< outstanding requests, by index
+  std::deque<int> pending_;               //!< indices waiting for room in the window
+
+  std::chrono::steady_clock::time_point download_start_;    //!< time the download was started
+  std::chrono::steady_clock::time_point list_request_time_; //!< time the list was last requested
+  std::chrono::steady_clock::time_point last_param_time_;   //!< time the last param arrived
+
+  bool have_rtt_;              //!< true once the round trip time has been measured
+  double srtt_ms_;             //!< smoothed round trip time
+  double rttvar_ms_;           //!< round trip time variation
+  double rto_ms_;              //!< retransmission timeout
+  size_t num_requests_;        //!< PARAM_REQUEST_READ messages sent, including retransmissions
+  size_t num_retransmissions_; //!< PARAM_REQUEST_READ messages that were retransmissions
+
+  std::string cache_dir_;        //!< directory of the cache files, or "" if the cache is disabled
+  std::string cache_name_;       //!< name of the vehicle the cache files belong to
+  std::string firmware_version_; //!< version of the connected firmware, or "" if not known yet
+  std::string vehicle_id_;       //!< MAVLink ids of the connected firmware, or "" if not known yet
+  CacheState cache_state_;       //!< progress of using the cache
+  std::vector<Param> cache_;     //!< cached parameters, by index
+  std::set<int> spot_check_;     //!< spot checked indices that have not been answered yet
+  std::deque<int> verify_queue_; //!< indices still to be verified in the background
+  bool cache_stale_;             //!< true if verification found values that differ from the cache
+  std::chrono::steady_clock::time_point last_verify_time_; //!< time of the last verify request
+
+  std::map<int, ParamSet> pending_sets_;               //!< unconfirmed sets by index
+  std::deque<int> param_set_queue_;                    //!< sets waiting for room in the window
+  size_t sets_in_flight_;                              //!< number of sets in flight
+  std::set<int> failed_sets_;                          //!< sets of the current upload that failed
+  size_t num_sets_;                                    //!< number of sets in the current upload
+  size_t num_set_retransmissions_;                     //!< retransmissions in the current upload
+  std::chrono::steady_clock::time_point upload_start_; //!< time the current upload started
+
   rclcpp::TimerBase::SharedPtr param_set_timer_;
   bool param_set_in_progress_;
   void param_set_timer_callback();
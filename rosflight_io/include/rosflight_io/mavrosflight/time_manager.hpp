@@ -43,10 +43,41 @@
 #include <rosflight_io/mavrosflight/mavlink_listener_interface.hpp>
 
 #include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 
 namespace mavrosflight
 {
+/**
+ * \brief Snapshot of the quality of the clock synchronization with the FCU
+ */
+struct TimeSyncStatus
+{
+  bool synchronized;                    //!< true once the offset estimate has converged
+  std::chrono::nanoseconds offset;      //!< current system time minus FCU time
+  double skew;                          //!< rate of change of the offset (FCU clock drift)
+  std::chrono::nanoseconds min_rtt;     //!< smallest round trip time in the window
+  std::chrono::nanoseconds residual;    //!< robust spread of the offset samples around the fit
+  size_t num_samples;                   //!< number of samples used by the current fit
+  size_t num_outliers;                  //!< number of samples rejected as outliers
+  size_t num_resets;                    //!< number of times the synchronization was restarted
+  std::chrono::nanoseconds sync_period; //!< current time between TIMESYNC requests
+};
+
+/**
+ * \brief Estimates the offset and skew between the FCU clock and the system clock
+ *
+ * TIMESYNC exchanges are kept in a sliding window. Only the exchanges with a round trip time
+ * close to the minimum in the window are used, since a delayed request or reply biases the
+ * offset by up to half the round trip time. A line is fit through the offsets of those exchanges
+ * to estimate both the offset and the skew of the FCU clock. Exchanges that disagree with the
+ * fit by more than their round trip time allows are rejected as outliers; several outliers in a
+ * row are treated as a genuine clock jump (e.g. an FCU reboot) and restart the synchronization.
+ *
+ * TIMESYNC requests are sent quickly while converging and back off once the estimate is stable.
+ */
 class TimeManager : MavlinkListenerInterface
 {
 public:
@@ -56,17 +87,84 @@ public:
 
   std::chrono::nanoseconds fcu_time_to_system_time(std::chrono::nanoseconds fcu_time);
 
+  /**
+   * \brief Get the current quality of the clock synchronization
+   */
+  TimeSyncStatus get_sync_status();
+
 private:
+  /**
+   * \brief A single TIMESYNC exchange
+   */
+  struct Sample
+  {
+    int64_t fcu_ns;    //!< FCU time of the reply
+    int64_t offset_ns; //!< measured system time minus FCU time
+    int64_t rtt_ns;    //!< round trip time of the exchange
+  };
+
+  //! number of exchanges kept in the window
+  static constexpr size_t WINDOW_SIZE = 32;
+  //! number of exchanges needed before the estimate can be considered converged
+  static constexpr size_t MIN_SYNC_SAMPLES = 8;
+  //! max residual for the estimate to be considered converged
+  static constexpr int64_t SYNCHRONIZED_RESIDUAL_NS = 1000000;
+  //! slack above the minimum round trip time for an exchange to be used in the fit
+  static constexpr int64_t MIN_RTT_MARGIN_NS = 500000;
+  //! time span the fit samples need to cover before the skew is estimated
+  static constexpr int64_t MIN_SKEW_SPAN_NS = 2000000000;
+  //! smallest outlier threshold, before adding half the round trip time
+  static constexpr int64_t MIN_OUTLIER_NS = 1000000;
+  //! outlier threshold in robust standard deviations of the residuals
+  static constexpr double OUTLIER_SIGMAS = 5.0;
+  //! number of outliers in a row that are treated as a clock jump
+  static constexpr size_t MAX_CONSECUTIVE_OUTLIERS = 5;
+  //! time between TIMESYNC requests while converging
+  static constexpr std::chrono::milliseconds FAST_SYNC_PERIOD{50};
+  //! time between TIMESYNC requests once converged
+  static constexpr std::chrono::milliseconds SLOW_SYNC_PERIOD{1000};
+
   MavlinkComm * const comm_;
   rclcpp::Node * const node_;
 
   rclcpp::TimerBase::SharedPtr time_sync_timer_;
   void timer_callback();
 
-  double offset_alpha_;
-  std::chrono::nanoseconds offset_ns_;
+  /**
+   * \brief Add a TIMESYNC exchange, rejecting it if it is an outlier
+   * \param sample The exchange to add
+   */
+  void add_sample(const Sample & sample);
+
+  /**
+   * \brief Refit the offset and skew to the exchanges in the window
+   */
+  void fit();
+
+  /**
+   * \brief Offset predicted by the current fit at the given FCU time, in nanoseconds
+   */
+  int64_t predict_offset(int64_t fcu_ns) const;
+
+  std::mutex mutex_;          //!< protects everything below, shared by the io and ROS threads
+  std::deque<Sample> window_; //!< most recent accepted exchanges
+
+  int64_t ref_fcu_ns_;     //!< FCU time the fit is referenced to
+  int64_t ref_offset_ns_;  //!< offset the fit is referenced to
+  double fit_offset_ns_;   //!< fitted offset at ref_fcu_ns_, relative to ref_offset_ns_
+  double skew_;            //!< fitted rate of change of the offset
+  double residual_ns_;     //!< robust standard deviation of the fit residuals
+  int64_t min_rtt_ns_;     //!< smallest round trip time in the window
+  size_t num_fit_samples_; //!< number of exchanges used by the current fit
 
   bool initialized_;
+  bool synchronized_;
+  size_t consecutive_outliers_;
+  size_t num_outliers_;
+  size_t num_resets_;
+
+  std::chrono::nanoseconds sync_period_;                 //!< current time between requests
+  std::chrono::steady_clock::time_point next_sync_time_; //!< when to send the next request
 };
 
 } // namespace mavrosflight
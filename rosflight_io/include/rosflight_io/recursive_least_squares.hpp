@@ -0,0 +1,135 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file recursive_least_squares.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_RECURSIVE_LEAST_SQUARES_H
+#define ROSFLIGHT_IO_RECURSIVE_LEAST_SQUARES_H
+
+#include <cmath>
+#include <cstddef>
+
+#include <eigen3/Eigen/Core>
+
+namespace rosflight_io
+{
+/**
+ * @class RecursiveLeastSquares
+ * @brief Least squares fit of a linear model, updated one sample at a time.
+ *
+ * Fits the coefficients c of y = c^T x in constant memory, so the fit can run over an arbitrarily
+ * long stream of samples. After every update the coefficients are the least squares fit to all
+ * samples so far, up to the weak prior from the initial covariance.
+ *
+ * @tparam N Number of regressors.
+ */
+template<int N>
+class RecursiveLeastSquares
+{
+public:
+  typedef Eigen::Matrix<double, N, 1> Vector;
+  typedef Eigen::Matrix<double, N, N> Matrix;
+
+  /**
+   * @brief Constructor for RecursiveLeastSquares.
+   *
+   * @param initial_covariance Covariance of the zero initial coefficients, large for a weak prior.
+   */
+  explicit RecursiveLeastSquares(double initial_covariance = 1e6) { reset(initial_covariance); }
+
+  /**
+   * @brief Discards all samples.
+   *
+   * @param initial_covariance Covariance of the zero initial coefficients, large for a weak prior.
+   */
+  void reset(double initial_covariance = 1e6)
+  {
+    coefficients_ = Vector::Zero();
+    P_ = Matrix::Identity() * initial_covariance;
+    sum_squares_ = 0.0;
+    count_ = 0;
+  }
+
+  /**
+   * @brief Adds a sample to the fit.
+   *
+   * @param x Regressors of the sample.
+   * @param y Measured value of the sample.
+   */
+  void update(const Vector & x, double y)
+  {
+    Vector Px = P_ * x;
+    double denominator = 1.0 + x.dot(Px);
+    double error = y - coefficients_.dot(x);
+
+    coefficients_ += Px * (error / denominator);
+    P_ -= Px * Px.transpose() / denominator;
+    P_ = 0.5 * (P_ + P_.transpose()); // keep rounding errors from making P asymmetric
+
+    // the product of the errors before and after the update is the increase of the sum of squares
+    sum_squares_ += error * error / denominator;
+    count_++;
+  }
+
+  /**
+   * @brief Coefficients of the least squares fit.
+   */
+  const Vector & coefficients() const { return coefficients_; }
+
+  /**
+   * @brief RMS residual of the samples from the fit, 0 before the first sample.
+   */
+  double residual() const { return count_ > 0 ? std::sqrt(sum_squares_ / count_) : 0.0; }
+
+  /**
+   * @brief Number of samples in the fit.
+   */
+  size_t count() const { return count_; }
+
+private:
+  /// Coefficients of the fit.
+  Vector coefficients_;
+  /// Covariance of the coefficients, scaled by the measurement noise variance.
+  Matrix P_;
+  /// Sum of the squared residuals of the samples from the fit.
+  double sum_squares_;
+  /// Number of samples in the fit.
+  size_t count_;
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_RECURSIVE_LEAST_SQUARES_H
@@ -41,8 +41,13 @@
 #ifndef ROSFLIGHT_IO_MAVROSFLIGHT_ROS_H
 #define ROSFLIGHT_IO_MAVROSFLIGHT_ROS_H
 
+#include <chrono>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <rclcpp/rclcpp.hpp>
 
@@ -53,6 +58,7 @@
 #include <std_msgs/msg/float32.hpp>
 #include <std_msgs/msg/int32.hpp>
 #include <std_msgs/msg/string.hpp>
+#include <std_msgs/msg/u_int32.hpp>
 
 #include <sensor_msgs/msg/fluid_pressure.hpp>
 #include <sensor_msgs/msg/imu.hpp>
@@ -70,21 +76,34 @@
 #include <rosflight_msgs/msg/barometer.hpp>
 #include <rosflight_msgs/msg/battery_status.hpp>
 #include <rosflight_msgs/msg/command.hpp>
+#include <rosflight_msgs/msg/command_latency.hpp>
 #include <rosflight_msgs/msg/error.hpp>
 #include <rosflight_msgs/msg/gnss.hpp>
 #include <rosflight_msgs/msg/gnss_full.hpp>
+#include <rosflight_msgs/msg/imu_batch.hpp>
+#include <rosflight_msgs/msg/latency_histogram.hpp>
 #include <rosflight_msgs/msg/output_raw.hpp>
 #include <rosflight_msgs/msg/rc_raw.hpp>
 #include <rosflight_msgs/msg/status.hpp>
+#include <rosflight_msgs/msg/time_sync_status.hpp>
 
+#include <rosflight_msgs/srv/param_changes.hpp>
+#include <rosflight_msgs/srv/param_diff.hpp>
 #include <rosflight_msgs/srv/param_file.hpp>
 #include <rosflight_msgs/srv/param_get.hpp>
+#include <rosflight_msgs/srv/param_get_many.hpp>
 #include <rosflight_msgs/srv/param_set.hpp>
+#include <rosflight_msgs/srv/param_set_many.hpp>
 
 #include <rosflight_io/mavrosflight/mavlink_comm.hpp>
 #include <rosflight_io/mavrosflight/mavlink_listener_interface.hpp>
+#include <rosflight_io/mavrosflight/mavlink_write_listener_interface.hpp>
 #include <rosflight_io/mavrosflight/mavrosflight.hpp>
 #include <rosflight_io/mavrosflight/param_listener_interface.hpp>
+#include <rosflight_io/boxcar_filter.hpp>
+#include <rosflight_io/latency_tracker.hpp>
+#include <rosflight_io/timestamp_smoother.hpp>
+#include <rosflight_io/type_adapters.hpp>
 
 namespace rosflight_io
 {
@@ -100,6 +119,7 @@ namespace rosflight_io
  */
 class ROSflightIO : public rclcpp::Node,
                     public mavrosflight::MavlinkListenerInterface,
+                    public mavrosflight::MavlinkWriteListenerInterface,
                     public mavrosflight::ParamListenerInterface
 {
 public:
@@ -113,8 +133,15 @@ public:
    * @code
    * rclcpp::spin(std::make_shared<rosflight_io::ROSflightIO>());
    * @endcode
+   *
+   * The "imu/data" and "attitude" topics are published using adapted types (see
+   * type_adapters.hpp). When intra-process communication is enabled through the node options,
+   * subscribers in the same process that use the adapted types receive the decoded structs
+   * without any conversion to ROS messages.
+   *
+   * @param options Node options, used to enable intra-process communication.
    */
-  ROSflightIO();
+  explicit ROSflightIO(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief Default de-constructor for ROSflightIO.
    *
@@ -133,13 +160,26 @@ public:
    */
   void handle_mavlink_message(const mavlink_message_t & msg) override;
 
+  /**
+   * @brief Callback for when an outgoing MAVLink message has been written to the port.
+   *
+   * Only used for latency tracing, where it marks the end of the enqueue to write stage of
+   * offboard commands.
+   *
+   * @param msgid ID of the written message.
+   * @param enqueue_time Time the message was queued for sending.
+   * @param write_time Time the message was written.
+   */
+  void on_message_written(uint32_t msgid, std::chrono::steady_clock::time_point enqueue_time,
+                          std::chrono::steady_clock::time_point write_time) override;
+
   /**
    * @brief Callback for when new parameters are received from firmware.
    *
    * This function is a callback for whenever MAVROSflight receives new parameters. The parameters
    * can be set by either the firmware or ROS.
    *
-   * Currently just prints a ROS message.
+   * Queues the parameter to be declared in the ROS parameter mirror, if enabled.
    *
    * @param name Name of parameter.
    * @param value Value of parameter.
@@ -151,7 +191,7 @@ public:
    * This function is a callback for whenever MAVROSflight receives a parameter that already
    * exists in MAVROSflight. The parameters can be set by either the firmware or ROS.
    *
-   * Currently just prints a ROS message.
+   * Prints a ROS message and queues the new value for the ROS parameter mirror, if enabled.
    *
    * @param name Name of parameter.
    * @param value Value of parameter.
@@ -166,6 +206,30 @@ public:
    * @param unsaved_changes Status of params, true if unsaved params exist, false if otherwise.
    */
   void on_params_saved_change(bool unsaved_changes) override;
+  /**
+   * @brief Callback for when a parameter set is confirmed or given up on.
+   *
+   * This function is a callback for whenever MAVROSflight finishes a parameter set request. It
+   * records the result in any pending "param_set_many" requests that have issued their set of the
+   * parameter, confirming it only if the firmware reports the value that request asked for, and
+   * sends the response of each request that has no parameters left to wait for. The reported
+   * value is also queued for the ROS parameter mirror, which undoes rejected sets.
+   *
+   * @param name Name of parameter.
+   * @param success True if the firmware confirmed the requested value.
+   * @param value Value of parameter reported by the firmware.
+   */
+  void on_param_set_result(std::string name, bool success, double value) override;
+  /**
+   * @brief Callback for when a parameter set is requested.
+   *
+   * When the set was requested by a "param_set_many" request on this thread, marks the parameter
+   * of that request as issued, so later results are matched against its requested value.
+   *
+   * @param name Name of parameter.
+   * @param value Requested value, cast to the type of the parameter.
+   */
+  void on_param_set_requested(std::string name, double value) override;
 
   /**
    * @brief Number of second between heartbeat messages.
@@ -179,14 +243,68 @@ public:
    */
   static constexpr long VERSION_PERIOD = 10;
   /**
-   * @brief Number of seconds between parameter requests.
-   *
-   * This value defines the number of seconds between requests for all parameters from the firmware.
-   * Requests terminate once all parameters have been received.
+   * @brief Number of seconds between command latency histogram messages.
    */
-  static constexpr long PARAMETER_PERIOD = 3;
+  static constexpr long LATENCY_PERIOD = 1;
+  /**
+   * @brief Number of most recent commands the command latency histograms are computed from.
+   */
+  static constexpr size_t LATENCY_WINDOW_SIZE = 1000;
+  /**
+   * @brief Number of seconds between time synchronization status messages.
+   */
+  static constexpr long TIME_SYNC_STATUS_PERIOD = 1;
+  /**
+   * @brief Number of milliseconds between updates of the ROS parameter mirror.
+   */
+  static constexpr long PARAM_MIRROR_PERIOD_MS = 20;
 
 private:
+  /**
+   * @brief Latest setpoint waiting to be sent by the command scheduler.
+   */
+  struct ScheduledMessage
+  {
+    /// True if a setpoint has been received.
+    bool valid = false;
+    /// True if the setpoint has timed out and the timeout has been reported.
+    bool stale = false;
+    /// True once the first transmission of the setpoint has been traced, so resends are not.
+    bool traced = false;
+    /// Packed MAVLink message to send.
+    mavlink_message_t msg;
+    /// Header stamp of the ROS message, zero if the ROS message has no header.
+    rclcpp::Time header_stamp;
+    /// ROS time the ROS message was received.
+    rclcpp::Time callback_time;
+    /// Steady clock time the ROS message was received.
+    std::chrono::steady_clock::time_point receive_time;
+  };
+
+  /**
+   * @brief A "param_set_many" request waiting for the firmware to confirm its parameters.
+   */
+  struct PendingParamSetMany
+  {
+    /// Id of the request, to find it again while its sets are issued.
+    uint64_t id = 0;
+    /// Header of the service request, needed to send the response.
+    std::shared_ptr<rmw_request_id_t> header;
+    /// Names of the parameters in the request.
+    std::vector<std::string> names;
+    /// True for each parameter that has not been confirmed or given up on yet.
+    std::vector<bool> waiting;
+    /// True for each parameter whose set has been issued. Results reported before that belong to
+    /// sets that were already in flight, and are ignored.
+    std::vector<bool> issued;
+    /// Requested value of each issued parameter, cast to the type of the parameter.
+    std::vector<double> requested;
+    /// Number of parameters still waiting.
+    size_t num_waiting = 0;
+    /// Response, filled in as the results arrive.
+    rosflight_msgs::srv::ParamSetMany::Response response;
+  };
+
   // MAVLink message handlers
   /**
    * @brief Handles heartbeat MAVLink messages.
@@ -222,7 +340,9 @@ private:
   /**
    * @brief Handles attitude quaternion MAVLink messages.
    *
-   * Calculates Euler angles from the quaternion and publishes both as a ROS topic.
+   * Calculates Euler angles from the quaternion and publishes both as a ROS topic. The attitude
+   * itself is published as an AttitudeSample, so no ROS message is built unless a subscriber
+   * needs one.
    *
    * @param msg Attitude quaternion message.
    */
@@ -230,7 +350,13 @@ private:
   /**
    * @brief Handles IMU MAVLink messages.
    *
-   * Receives MAVLink IMU message and republishes it as a ROS topic.
+   * Receives MAVLink IMU message and republishes it as a ROS topic. The decoded message is
+   * published as an ImuSample, so no ROS message is built unless a subscriber needs one. If IMU
+   * batching is enabled, the sample is also appended to the pending "imu/batch" message. If an
+   * IMU output rate is set, samples are averaged down to that rate before being published.
+   *
+   * Unless disabled, stamps are smoothed by a TimestampSmoother, and gaps in the FCU timestamps
+   * are published on "imu/dropped_samples".
    *
    * @param msg IMU message.
    */
@@ -267,7 +393,8 @@ private:
   /**
    * @brief Handles magnetometer MAVLink messages.
    *
-   * Receives magnetometer data from MAVLink and publishes it on "magnetometer" topic.
+   * Receives magnetometer data from MAVLink and publishes it on "magnetometer" topic, averaged
+   * down to the requested output rate if one is set.
    *
    * @param msg Magnetometer message.
    */
@@ -364,7 +491,9 @@ private:
   /**
    * @brief "command" topic subscription callback.
    *
-   * This function is called anytime rosflight_io receives a message on the "command" topic.
+   * This function is called anytime rosflight_io receives a message on the "command" topic. If
+   * the command scheduler is enabled, the command is stored to be sent by the scheduler,
+   * otherwise it is sent immediately.
    *
    * @param msg Populated ROSflight Command message.
    */
@@ -382,7 +511,8 @@ private:
    * @brief "external_attitude" topic subscription callback.
    *
    * This function is called anytime rosflight_io receives a message on the "external_attitude"
-   * topic, where it sends the external attitude over MAVLink to the firmware.
+   * topic, where it sends the external attitude over MAVLink to the firmware (through the command
+   * scheduler, if enabled).
    *
    * @param msg Populated ROSflight Attitude message
    */
@@ -401,6 +531,19 @@ private:
    */
   bool paramGetSrvCallback(const rosflight_msgs::srv::ParamGet::Request::SharedPtr & req,
                            const rosflight_msgs::srv::ParamGet::Response::SharedPtr & res);
+  /**
+   * @brief "param_changes" service callback.
+   *
+   * This function is called anytime the "param_changes" ROS service is called. It returns the
+   * parameter changes recorded by MAVROSflight after the requested sequence number, so clients can
+   * track the parameters without reading each of them.
+   *
+   * @param req ROSflight ParamChanges service request.
+   * @param res ROSflight ParamChanges service response.
+   * @return True
+   */
+  bool paramChangesSrvCallback(const rosflight_msgs::srv::ParamChanges::Request::SharedPtr & req,
+                               const rosflight_msgs::srv::ParamChanges::Response::SharedPtr & res);
   /**
    * @brief "param_set" service callback.
    *
@@ -413,6 +556,37 @@ private:
    */
   bool paramSetSrvCallback(const rosflight_msgs::srv::ParamSet::Request::SharedPtr & req,
                            const rosflight_msgs::srv::ParamSet::Response::SharedPtr & res);
+  /**
+   * @brief "param_get_many" service callback.
+   *
+   * This function is called anytime the "param_get_many" ROS service is called. It retrieves
+   * each of the requested params from MAVROSflight and returns them in the response.
+   *
+   * @param req ROSflight ParamGetMany service request.
+   * @param res ROSflight ParamGetMany service response.
+   * @return True
+   */
+  bool paramGetManySrvCallback(const rosflight_msgs::srv::ParamGetMany::Request::SharedPtr & req,
+                               const rosflight_msgs::srv::ParamGetMany::Response::SharedPtr & res);
+  /**
+   * @brief "param_set_many" service callback.
+   *
+   * This function is called anytime the "param_set_many" ROS service is called. It sends all of
+   * the params in the request to MAVROSflight at once, which pipelines them to the firmware. The
+   * response is deferred until the firmware has confirmed or rejected every param, and is sent
+   * from on_param_set_result.
+   *
+   * @param header ROS service request header, used to send the deferred response.
+   * @param req ROSflight ParamSetMany service request.
+   */
+  void paramSetManySrvCallback(const std::shared_ptr<rmw_request_id_t> & header,
+                               const rosflight_msgs::srv::ParamSetMany::Request::SharedPtr & req);
+  /**
+   * @brief Sends the response of a "param_set_many" request.
+   *
+   * @param pending The request, with the results of all of its params filled in.
+   */
+  void sendParamSetManyResponse(PendingParamSetMany & pending);
   /**
    * @brief "param_write" service callback.
    *
@@ -451,6 +625,19 @@ private:
    */
   bool paramLoadFromFileCallback(const rosflight_msgs::srv::ParamFile::Request::SharedPtr & req,
                                  const rosflight_msgs::srv::ParamFile::Response::SharedPtr & res);
+  /**
+   * @brief "param_diff_file" service callback.
+   *
+   * This function is called anytime the "param_diff_file" ROS service is called. It compares the
+   * params in MAVROSflight to the file given in the request and returns the differences. If
+   * requested, only the params that differ are then sent to the firmware.
+   *
+   * @param req ROSflight ParamDiff service request.
+   * @param res ROSflight ParamDiff service response.
+   * @return True
+   */
+  bool paramDiffFileCallback(const rosflight_msgs::srv::ParamDiff::Request::SharedPtr & req,
+                             const rosflight_msgs::srv::ParamDiff::Response::SharedPtr & res);
   /**
    * @brief "calibrate_imu" service callback.
    *
@@ -525,13 +712,6 @@ private:
                                      const std_srvs::srv::Trigger::Response::SharedPtr & res);
 
   // timer callbacks
-  /**
-   * @brief Callback for parameter request timer.
-   *
-   * This function is called repeatedly until MAVROSflight has received all parameters from the
-   * firmware. It outputs ROS info/error messages with the current status of this request.
-   */
-  void paramTimerCallback();
   /**
    * @brief Callback for firmware version request timer.
    *
@@ -546,6 +726,67 @@ private:
    * for the firmware to send a heartbeat message.
    */
   void heartbeatTimerCallback();
+  /**
+   * @brief Callback for the IMU batch flush timer.
+   *
+   * Publishes the pending IMU batch if its oldest sample has been waiting longer than the
+   * maximum batch latency. This bounds the delay when IMU messages stop arriving mid-batch.
+   */
+  void imuBatchTimerCallback();
+  /**
+   * @brief Callback for the command latency histogram timer.
+   *
+   * Publishes the rolling latency histogram of each stage of the command path.
+   */
+  void latencyTimerCallback();
+  /**
+   * @brief Callback for the command scheduler timer.
+   *
+   * Sends the latest command and external attitude, unless they are older than the command
+   * timeout. Only runs if the command scheduler is enabled.
+   */
+  void commandTimerCallback();
+  /**
+   * @brief Callback for the time synchronization status timer.
+   *
+   * Publishes the quality of the clock synchronization with the firmware on the "time_sync"
+   * topic.
+   */
+  void timeSyncTimerCallback();
+  /**
+   * @brief Callback for the ROS parameter mirror timer.
+   *
+   * Declares or updates the ROS parameters queued from the MAVLink thread, without sending them
+   * back to the firmware. A parameter override given for a firmware parameter is only sent to the
+   * firmware when push_param_overrides is set, otherwise the mirror is reset to the firmware value.
+   * This is done on an executor thread, since the node parameter lock is held while the set
+   * parameters callback takes the MAVROSflight param lock, so the MAVLink thread must never take
+   * them the other way around.
+   */
+  void paramMirrorTimerCallback();
+
+  // parameter callbacks
+  /**
+   * @brief Callback for changes to the ROS parameters of this node.
+   *
+   * Sends changes to the ROS parameters that mirror firmware parameters to MAVROSflight, which
+   * pipelines them to the firmware. Every parameter in the request is checked before anything is
+   * sent, so a group set with set_parameters_atomically is either sent as one batch or rejected
+   * as a whole. Every change is sent, even one that matches the last confirmed value, except for
+   * the writes of the mirror itself.
+   *
+   * @param parameters The parameters being set.
+   * @return Whether the parameters were accepted.
+   */
+  rcl_interfaces::msg::SetParametersResult
+  parametersCallback(const std::vector<rclcpp::Parameter> & parameters);
+  /**
+   * @brief Queues a firmware parameter value for the ROS parameter mirror.
+   *
+   * @param name Name of parameter.
+   * @param value Value of parameter reported by the firmware.
+   */
+  void queue_param_mirror_update(const std::string & name, double value);
 
   // helpers
   /**
@@ -575,6 +816,19 @@ private:
    * @return ROS time object of current ROS time.
    */
   rclcpp::Time fcu_time_to_ros_time(std::chrono::nanoseconds fcu_time);
+  /**
+   * @brief Publishes the pending IMU batch on the "imu/batch" topic and starts a new one.
+   *
+   * Must be called with imu_batch_mutex_ held. Does nothing if the batch is empty.
+   */
+  void publish_imu_batch();
+
+  /// Callback group for the control input subscriptions.
+  rclcpp::CallbackGroup::SharedPtr control_callback_group_;
+  /// Callback group for the ROS services.
+  rclcpp::CallbackGroup::SharedPtr service_callback_group_;
+  /// Callback group for the ROS timers.
+  rclcpp::CallbackGroup::SharedPtr timer_callback_group_;
 
   /// "command" ROS topic subscription.
   rclcpp::Subscription<rosflight_msgs::msg::Command>::SharedPtr command_sub_;
@@ -586,7 +840,15 @@ private:
   /// "unsaved_params" ROS topic publisher.
   rclcpp::Publisher<std_msgs::msg::Bool>::SharedPtr unsaved_params_pub_;
   /// "imu/data" ROS topic publisher.
-  rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_pub_;
+  rclcpp::Publisher<ImuTypeAdapter>::SharedPtr imu_pub_;
+  /// "command_latency" ROS topic publisher.
+  rclcpp::Publisher<rosflight_msgs::msg::CommandLatency>::SharedPtr command_latency_pub_;
+  /// "command_latency/histograms" ROS topic publisher.
+  rclcpp::Publisher<rosflight_msgs::msg::LatencyHistogram>::SharedPtr latency_histogram_pub_;
+  /// "imu/batch" ROS topic publisher.
+  rclcpp::Publisher<rosflight_msgs::msg::ImuBatch>::SharedPtr imu_batch_pub_;
+  /// "imu/dropped_samples" ROS topic publisher.
+  rclcpp::Publisher<std_msgs::msg::UInt32>::SharedPtr imu_dropped_pub_;
   /// "imu/temperature" ROS topic publisher.
   rclcpp::Publisher<sensor_msgs::msg::Temperature>::SharedPtr imu_temp_pub_;
   /// "output_raw" ROS topic publisher.
@@ -612,11 +874,13 @@ private:
   /// "magnetometer" ROS topic publisher.
   rclcpp::Publisher<sensor_msgs::msg::MagneticField>::SharedPtr mag_pub_;
   /// "attitude" ROS topic publisher.
-  rclcpp::Publisher<rosflight_msgs::msg::Attitude>::SharedPtr attitude_pub_;
+  rclcpp::Publisher<AttitudeTypeAdapter>::SharedPtr attitude_pub_;
   /// "attitude/euler" ROS topic publisher.
   rclcpp::Publisher<geometry_msgs::msg::Vector3Stamped>::SharedPtr euler_pub_;
   /// "status" ROS topic publisher.
   rclcpp::Publisher<rosflight_msgs::msg::Status>::SharedPtr status_pub_;
+  /// "time_sync" ROS topic publisher.
+  rclcpp::Publisher<rosflight_msgs::msg::TimeSyncStatus>::SharedPtr time_sync_pub_;
   /// "version" ROS topic publisher.
   rclcpp::Publisher<std_msgs::msg::String>::SharedPtr version_pub_;
   /// "lidar" ROS topic publisher.
@@ -636,14 +900,22 @@ private:
 
   /// "param_get" ROS service.
   rclcpp::Service<rosflight_msgs::srv::ParamGet>::SharedPtr param_get_srv_;
+  /// "param_changes" ROS service.
+  rclcpp::Service<rosflight_msgs::srv::ParamChanges>::SharedPtr param_changes_srv_;
   /// "param_set" ROS service.
   rclcpp::Service<rosflight_msgs::srv::ParamSet>::SharedPtr param_set_srv_;
+  /// "param_get_many" ROS service.
+  rclcpp::Service<rosflight_msgs::srv::ParamGetMany>::SharedPtr param_get_many_srv_;
+  /// "param_set_many" ROS service.
+  rclcpp::Service<rosflight_msgs::srv::ParamSetMany>::SharedPtr param_set_many_srv_;
   /// "param_write" ROS service.
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr param_write_srv_;
   /// "param_save_to_file" ROS service.
   rclcpp::Service<rosflight_msgs::srv::ParamFile>::SharedPtr param_save_to_file_srv_;
   /// "param_load_from_file" ROS service.
   rclcpp::Service<rosflight_msgs::srv::ParamFile>::SharedPtr param_load_from_file_srv_;
+  /// "param_diff_file" ROS service.
+  rclcpp::Service<rosflight_msgs::srv::ParamDiff>::SharedPtr param_diff_file_srv_;
   /// "calibrate_imu" ROS service.
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr imu_calibrate_bias_srv_;
   /// "calibrate_rc_trim" ROS service.
@@ -657,12 +929,31 @@ private:
   /// "reboot_to_bootloader" ROS service.
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr reboot_bootloader_srv_;
 
-  /// ROS timer for param requests.
-  rclcpp::TimerBase::SharedPtr param_timer_;
   /// ROS timer for firmware version requests.
   rclcpp::TimerBase::SharedPtr version_timer_;
   /// ROS timer for heartbeat requests.
   rclcpp::TimerBase::SharedPtr heartbeat_timer_;
+  /// ROS timer for flushing stale IMU batches.
+  rclcpp::TimerBase::SharedPtr imu_batch_timer_;
+  /// ROS timer for publishing command latency histograms.
+  rclcpp::TimerBase::SharedPtr latency_timer_;
+  /// ROS timer for the command scheduler.
+  rclcpp::TimerBase::SharedPtr command_timer_;
+  /// ROS timer for time synchronization status messages.
+  rclcpp::TimerBase::SharedPtr time_sync_timer_;
+  /// ROS timer for updating the ROS parameter mirror.
+  rclcpp::TimerBase::SharedPtr param_mirror_timer_;
+
+  /// Handle of the set parameters callback.
+  rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr parameters_callback_handle_;
+  /// True if the firmware parameters are mirrored as ROS parameters.
+  bool mirror_params_ = false;
+  /// True if parameter overrides given for firmware parameters are sent to the firmware.
+  bool push_param_overrides_ = false;
+  /// Firmware parameter values waiting to be written to the ROS parameter mirror, by name.
+  std::map<std::string, double> param_mirror_updates_;
+  /// Mutex protecting the pending ROS parameter mirror updates.
+  std::mutex param_mirror_mutex_;
 
   /// Quaternion ROS message, for passing quaternion data between functions.
   geometry_msgs::msg::Quaternion attitude_quat_;
@@ -672,6 +963,46 @@ private:
   /// Frame ID string, used to include frame in published ROS message.
   std::string frame_id_;
 
+  /// Number of IMU samples per "imu/batch" message, 0 if batching is disabled.
+  size_t imu_batch_size_;
+  /// Maximum time a sample waits in a pending IMU batch before the batch is published.
+  std::chrono::nanoseconds imu_batch_max_latency_;
+  /// Pending IMU batch, filled on the MAVLink thread and flushed from either thread.
+  rosflight_msgs::msg::ImuBatch imu_batch_msg_;
+  /// Steady clock time the first sample of the pending IMU batch was received.
+  std::chrono::steady_clock::time_point imu_batch_start_;
+  /// Mutex protecting the pending IMU batch.
+  std::mutex imu_batch_mutex_;
+
+  /// Decimation filter for the "imu/data" and "imu/temperature" topics.
+  BoxcarFilter imu_filter_;
+  /// Decimation filter for the "magnetometer" topic.
+  BoxcarFilter mag_filter_;
+
+  /// True if IMU stamps are smoothed, false if each is converted independently.
+  bool imu_stamp_smoothing_;
+  /// Timestamp smoother for the IMU stream.
+  TimestampSmoother imu_stamp_smoother_;
+
+  /// Command path latency tracker, null if latency tracing is disabled.
+  std::unique_ptr<LatencyTracker> latency_tracker_;
+
+  /// Time after which the command scheduler stops sending a setpoint that has not been updated.
+  std::chrono::nanoseconds command_timeout_;
+  /// Latest "command" setpoint for the command scheduler.
+  ScheduledMessage scheduled_command_;
+  /// Latest "external_attitude" setpoint for the command scheduler.
+  ScheduledMessage scheduled_attitude_;
+  /// Mutex protecting the scheduled setpoints.
+  std::mutex command_mutex_;
+
+  /// "param_set_many" requests waiting for the firmware to confirm their params.
+  std::list<PendingParamSetMany> pending_param_sets_;
+  /// Id of the next "param_set_many" request.
+  uint64_t next_param_set_many_id_ = 1;
+  /// Mutex protecting the pending "param_set_many" requests, never held while calling MAVROSflight.
+  std::mutex pending_param_sets_mutex_;
+
   /// Pointer to Mavlink communication object, used by MavROSflight.
   mavrosflight::MavlinkComm * mavlink_comm_;
   /// Pointer to MavROSflight instance, which is used for all serial communication.
@@ -0,0 +1,116 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file sphere_coverage.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_SPHERE_COVERAGE_H
+#define ROSFLIGHT_IO_SPHERE_COVERAGE_H
+
+#include <cstddef>
+#include <vector>
+
+#include <eigen3/Eigen/Core>
+
+namespace rosflight_io
+{
+/**
+ * @class SphereCoverage
+ * @brief Tracks how much of the unit sphere a set of directions covers.
+ *
+ * The sphere is divided into the Voronoi cells of the vertices of a subdivided icosahedron, which
+ * are close to equal in area. Every subdivision level splits each face into four, so level 0 has
+ * 12 bins, level 1 has 42, level 2 has 162 and level 3 has 642.
+ *
+ * Each bin accepts a limited number of directions, so a sensor held in one orientation does not
+ * add more samples once its bin is full.
+ */
+class SphereCoverage
+{
+public:
+  /**
+   * @brief Constructor for SphereCoverage.
+   *
+   * @param subdivisions Number of times the icosahedron faces are subdivided.
+   * @param samples_per_bin Number of directions each bin accepts, 0 for no limit.
+   */
+  SphereCoverage(int subdivisions, size_t samples_per_bin);
+
+  /**
+   * @brief Finds the bin a direction falls into.
+   *
+   * @param direction Direction to look up, does not need to be normalized.
+   * @return Index of the bin, the one whose center is closest to the direction.
+   */
+  size_t bin(const Eigen::Vector3d & direction) const;
+
+  /**
+   * @brief Adds a direction to its bin, if the bin is not full.
+   *
+   * @param direction Direction to add, does not need to be normalized.
+   * @return True if the direction was added, false if its bin was already full or the direction
+   * is zero.
+   */
+  bool add(const Eigen::Vector3d & direction);
+
+  /**
+   * @brief Fraction of the bins that contain at least one direction.
+   */
+  double coverage() const { return (double) num_occupied_ / counts_.size(); }
+
+  /**
+   * @brief Number of bins the sphere is divided into.
+   */
+  size_t num_bins() const { return counts_.size(); }
+
+  /**
+   * @brief Empties all bins.
+   */
+  void reset();
+
+private:
+  /// Unit vectors to the center of each bin.
+  std::vector<Eigen::Vector3d> centers_;
+  /// Number of directions added to each bin.
+  std::vector<size_t> counts_;
+  /// Number of bins that contain at least one direction.
+  size_t num_occupied_;
+  /// Number of directions each bin accepts, 0 for no limit.
+  size_t samples_per_bin_;
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_SPHERE_COVERAGE_H
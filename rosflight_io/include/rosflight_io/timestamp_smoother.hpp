@@ -0,0 +1,140 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file timestamp_smoother.hpp
+ * @author agent <agent\@local>
+ */
+
+#ifndef ROSFLIGHT_IO_TIMESTAMP_SMOOTHER_H
+#define ROSFLIGHT_IO_TIMESTAMP_SMOOTHER_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace rosflight_io
+{
+/**
+ * @class TimestampSmoother
+ * @brief Produces low-jitter, monotonic ROS stamps for a periodic sensor stream.
+ *
+ * Converting each FCU timestamp to ROS time independently passes every small adjustment of the
+ * clock synchronization straight through to the stamps. Instead, this class tracks the offset
+ * between the FCU timestamps of one stream and their converted ROS times with a second-order
+ * phase-locked loop, which follows offset drift while filtering out short-term adjustments.
+ *
+ * The nominal sample period is learned from the FCU timestamps. A gap of more than 1.5 periods
+ * is reported as dropped samples, and the loop is re-anchored at the new sample instead of
+ * smoothing across the gap. Several gaps of the same length in a row are a drop in the sample
+ * rate rather than dropped samples, so their length is adopted as the new period.
+ */
+class TimestampSmoother
+{
+public:
+  /**
+   * @brief Constructor for TimestampSmoother.
+   */
+  TimestampSmoother();
+
+  /**
+   * @brief Computes the smoothed stamp of a sample.
+   *
+   * @param fcu_time FCU timestamp of the sample.
+   * @param ros_time ROS time converted from the FCU timestamp by the clock synchronization.
+   * @param dropped_samples Set to the number of samples missing before this one, if any.
+   * @return Smoothed ROS time of the sample.
+   */
+  std::chrono::nanoseconds update(std::chrono::nanoseconds fcu_time,
+                                  std::chrono::nanoseconds ros_time, uint64_t & dropped_samples);
+
+  /**
+   * @brief Converts an FCU time of this stream to ROS time using the current smoothed offset.
+   *
+   * Useful for times derived from the sample timestamps, such as the mean time of an average.
+   *
+   * @param fcu_time FCU time to convert.
+   * @return Corresponding ROS time.
+   */
+  std::chrono::nanoseconds to_ros_time(std::chrono::nanoseconds fcu_time) const;
+
+  /**
+   * @brief Forgets all state, so the next sample re-anchors the loop.
+   */
+  void reset();
+
+  /// Gain applied to the offset error of each sample.
+  static constexpr double PHASE_GAIN = 0.02;
+  /// Gain applied to the offset error for the offset drift rate (critically damped loop).
+  static constexpr double FREQUENCY_GAIN = PHASE_GAIN * PHASE_GAIN / 4.0;
+  /// Offset error beyond which the loop re-anchors instead of tracking (e.g. a sync reset).
+  static constexpr std::chrono::milliseconds MAX_OFFSET_ERROR{5};
+  /// Gap between samples, in nominal periods, that is treated as dropped samples.
+  static constexpr double GAP_THRESHOLD = 1.5;
+  /// Weight of each new sample interval in the nominal period estimate.
+  static constexpr double PERIOD_ALPHA = 0.01;
+  /// Number of consecutive gaps of the same length that are taken as a lower sample rate.
+  static constexpr int RATE_CHANGE_GAPS = 3;
+  /// Relative difference in length up to which consecutive gaps count as the same length.
+  static constexpr double RATE_CHANGE_TOLERANCE = 0.1;
+
+private:
+  /**
+   * @brief Re-anchors the loop at a sample, discarding the offset drift estimate.
+   * @param fcu_time FCU timestamp of the sample.
+   * @param ros_time Converted ROS time of the sample.
+   */
+  void anchor(std::chrono::nanoseconds fcu_time, std::chrono::nanoseconds ros_time);
+
+  /// True once the first sample has been received.
+  bool initialized_;
+  /// FCU timestamp of the previous sample.
+  std::chrono::nanoseconds last_fcu_time_;
+  /// Smoothed stamp of the previous sample.
+  std::chrono::nanoseconds last_stamp_;
+  /// Reference for offset_, to keep the loop state small.
+  std::chrono::nanoseconds offset_reference_;
+  /// Smoothed ROS minus FCU time at the previous sample, relative to offset_reference_, in ns.
+  double offset_;
+  /// Rate of change of the offset, in ns per ns of FCU time.
+  double offset_rate_;
+  /// Estimated nominal sample period in ns, 0 until two samples have been received.
+  double period_;
+  /// Length of the current run of gaps in ns.
+  double gap_length_;
+  /// Number of consecutive gaps of about gap_length_.
+  int gap_count_;
+};
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_TIMESTAMP_SMOOTHER_H
@@ -0,0 +1,164 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file type_adapters.hpp
+ * @author agent <agent\@local>
+ *
+ * rclcpp::TypeAdapter specializations for the high-rate topics published by rosflight_io.
+ */
+
+#ifndef ROSFLIGHT_IO_TYPE_ADAPTERS_H
+#define ROSFLIGHT_IO_TYPE_ADAPTERS_H
+
+#include <string>
+
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp/type_adapter.hpp>
+
+#include <geometry_msgs/msg/quaternion.hpp>
+#include <sensor_msgs/msg/imu.hpp>
+
+#include <rosflight_msgs/msg/attitude.hpp>
+
+#include <rosflight_io/mavrosflight/mavlink_bridge.hpp>
+
+namespace rosflight_io
+{
+/**
+ * @brief Decoded IMU sample, as received from the firmware.
+ *
+ * This is the type rosflight_io publishes on the "imu/data" topic. Intra-process subscribers that
+ * subscribe with the adapted type receive this struct directly; everyone else gets a
+ * sensor_msgs::msg::Imu, converted only when it is needed.
+ */
+struct ImuSample
+{
+  rclcpp::Time stamp;                         ///< Estimated ROS time of the measurement.
+  std::string frame_id;                       ///< Frame ID for the published message.
+  mavlink_small_imu_t imu;                    ///< Decoded MAVLink IMU message.
+  geometry_msgs::msg::Quaternion orientation; ///< Latest attitude reported by the firmware.
+};
+
+/**
+ * @brief Decoded attitude sample, as received from the firmware.
+ *
+ * This is the type rosflight_io publishes on the "attitude" topic, converted to a
+ * rosflight_msgs::msg::Attitude only when it is needed.
+ */
+struct AttitudeSample
+{
+  rclcpp::Time stamp;                     ///< Estimated ROS time of the measurement.
+  mavlink_attitude_quaternion_t attitude; ///< Decoded MAVLink attitude quaternion message.
+};
+
+} // namespace rosflight_io
+
+template<>
+struct rclcpp::TypeAdapter<rosflight_io::ImuSample, sensor_msgs::msg::Imu>
+{
+  using is_specialized = std::true_type;
+  using custom_type = rosflight_io::ImuSample;
+  using ros_message_type = sensor_msgs::msg::Imu;
+
+  static void convert_to_ros_message(const custom_type & source, ros_message_type & destination)
+  {
+    destination.header.stamp = source.stamp;
+    destination.header.frame_id = source.frame_id;
+    destination.linear_acceleration.x = source.imu.xacc;
+    destination.linear_acceleration.y = source.imu.yacc;
+    destination.linear_acceleration.z = source.imu.zacc;
+    destination.angular_velocity.x = source.imu.xgyro;
+    destination.angular_velocity.y = source.imu.ygyro;
+    destination.angular_velocity.z = source.imu.zgyro;
+    destination.orientation = source.orientation;
+  }
+
+  static void convert_to_custom(const ros_message_type & source, custom_type & destination)
+  {
+    destination.stamp = source.header.stamp;
+    destination.frame_id = source.header.frame_id;
+    destination.imu = mavlink_small_imu_t();
+    destination.imu.xacc = (float) source.linear_acceleration.x;
+    destination.imu.yacc = (float) source.linear_acceleration.y;
+    destination.imu.zacc = (float) source.linear_acceleration.z;
+    destination.imu.xgyro = (float) source.angular_velocity.x;
+    destination.imu.ygyro = (float) source.angular_velocity.y;
+    destination.imu.zgyro = (float) source.angular_velocity.z;
+    destination.orientation = source.orientation;
+  }
+};
+
+template<>
+struct rclcpp::TypeAdapter<rosflight_io::AttitudeSample, rosflight_msgs::msg::Attitude>
+{
+  using is_specialized = std::true_type;
+  using custom_type = rosflight_io::AttitudeSample;
+  using ros_message_type = rosflight_msgs::msg::Attitude;
+
+  static void convert_to_ros_message(const custom_type & source, ros_message_type & destination)
+  {
+    destination.header.stamp = source.stamp;
+    destination.attitude.w = source.attitude.q1;
+    destination.attitude.x = source.attitude.q2;
+    destination.attitude.y = source.attitude.q3;
+    destination.attitude.z = source.attitude.q4;
+    destination.angular_velocity.x = source.attitude.rollspeed;
+    destination.angular_velocity.y = source.attitude.pitchspeed;
+    destination.angular_velocity.z = source.attitude.yawspeed;
+  }
+
+  static void convert_to_custom(const ros_message_type & source, custom_type & destination)
+  {
+    destination.stamp = source.header.stamp;
+    destination.attitude = mavlink_attitude_quaternion_t();
+    destination.attitude.q1 = (float) source.attitude.w;
+    destination.attitude.q2 = (float) source.attitude.x;
+    destination.attitude.q3 = (float) source.attitude.y;
+    destination.attitude.q4 = (float) source.attitude.z;
+    destination.attitude.rollspeed = (float) source.angular_velocity.x;
+    destination.attitude.pitchspeed = (float) source.angular_velocity.y;
+    destination.attitude.yawspeed = (float) source.angular_velocity.z;
+  }
+};
+
+namespace rosflight_io
+{
+/// Adapted type for publishing ImuSample structs as sensor_msgs::msg::Imu.
+using ImuTypeAdapter = rclcpp::TypeAdapter<ImuSample, sensor_msgs::msg::Imu>;
+/// Adapted type for publishing AttitudeSample structs as rosflight_msgs::msg::Attitude.
+using AttitudeTypeAdapter = rclcpp::TypeAdapter<AttitudeSample, rosflight_msgs::msg::Attitude>;
+
+} // namespace rosflight_io
+
+#endif // ROSFLIGHT_IO_TYPE_ADAPTERS_H
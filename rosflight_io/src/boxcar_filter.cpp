@@ -0,0 +1,108 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file boxcar_filter.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <algorithm>
+
+#include <rosflight_io/boxcar_filter.hpp>
+
+namespace rosflight_io
+{
+BoxcarFilter::BoxcarFilter(size_t num_channels)
+    : period_(0)
+    , window_end_(0)
+    , sum_(num_channels, 0.0)
+    , time_sum_(0)
+    , count_(0)
+{}
+
+void BoxcarFilter::set_rate(double rate_hz)
+{
+  if (rate_hz > 0.0) {
+    period_ = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate_hz));
+  } else {
+    period_ = std::chrono::nanoseconds(0);
+  }
+  reset();
+}
+
+bool BoxcarFilter::update(std::chrono::nanoseconds time, const double * sample,
+                          std::chrono::nanoseconds & output_time, double * output)
+{
+  if (!enabled()) {
+    output_time = time;
+    std::copy(sample, sample + sum_.size(), output);
+    return true;
+  }
+
+  // Timestamps went backwards (e.g. FCU reboot), so the partial window is meaningless
+  if (count_ > 0 && time < window_end_ - period_) {
+    reset();
+  }
+
+  // The first sample past the end of the window completes it
+  bool window_complete = false;
+  if (count_ > 0 && time >= window_end_) {
+    for (size_t i = 0; i < sum_.size(); i++) { output[i] = sum_[i] / count_; }
+    output_time = window_end_ - period_ + time_sum_ / count_;
+    window_complete = true;
+
+    reset();
+    window_end_ += period_;
+  }
+
+  // Align a new window to this sample if it does not fall in the next window (first sample, or
+  // a gap in the data)
+  if (count_ == 0 && (time < window_end_ - period_ || time >= window_end_)) {
+    window_end_ = time + period_;
+  }
+
+  for (size_t i = 0; i < sum_.size(); i++) { sum_[i] += sample[i]; }
+  time_sum_ += time - (window_end_ - period_);
+  count_++;
+
+  return window_complete;
+}
+
+void BoxcarFilter::reset()
+{
+  std::fill(sum_.begin(), sum_.end(), 0.0);
+  time_sum_ = std::chrono::nanoseconds(0);
+  count_ = 0;
+}
+
+} // namespace rosflight_io
@@ -0,0 +1,271 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file imu_temp_cal.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#include <rosflight_io/imu_temp_cal.hpp>
+
+namespace rosflight_io
+{
+CalibrateImuTemp::CalibrateImuTemp()
+    : Node("calibrate_imu_temp")
+    , calibrating_(false)
+    , first_time_(true)
+    , start_time_(0)
+    , reference_temperature_(0)
+    , min_temperature_(0)
+    , max_temperature_(0)
+    , num_rejected_(0)
+{
+  this->declare_parameter("calibration_time", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("temperature_span", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("max_gyro_rate", rclcpp::PARAMETER_DOUBLE);
+  calibration_time_ = this->get_parameter_or("calibration_time", 3600.0);
+  temperature_span_ = this->get_parameter_or("temperature_span", 0.0);
+  max_gyro_rate_ = this->get_parameter_or("max_gyro_rate", 0.1);
+
+  param_set_client_ = this->create_client<rosflight_msgs::srv::ParamSetMany>("param_set_many");
+  param_get_client_ = this->create_client<rosflight_msgs::srv::ParamGetMany>("param_get_many");
+}
+
+void CalibrateImuTemp::run()
+{
+  // keep the current calibration, to put it back if this one doesn't complete
+  std::vector<double> previous;
+  if (!get_params(CALIBRATION_PARAMS, &previous)) {
+    RCLCPP_FATAL(this->get_logger(), "Failed to read calibration parameters");
+    return;
+  }
+
+  // reset calibration parameters, so the IMU data is not compensated already
+  std::vector<double> zeros(CALIBRATION_PARAMS.size(), 0.0);
+  bool success = set_params(CALIBRATION_PARAMS, zeros);
+  if (!success) {
+    RCLCPP_FATAL(this->get_logger(), "Failed to reset calibration parameters");
+    restore_params(previous);
+    return;
+  }
+
+  for (auto & fit : fits_) { fit.reset(); }
+  num_rejected_ = 0;
+  first_time_ = true;
+  calibrating_ = true;
+
+  // Subscribe to the IMU and its temperature, which rosflight_io publishes with the same stamp
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = 10;
+  imu_subscriber_.subscribe(shared_from_this(), "imu/data", qos_profile);
+  temperature_subscriber_.subscribe(shared_from_this(), "imu/temperature", qos_profile);
+  synchronizer_ = std::make_shared<
+    message_filters::TimeSynchronizer<sensor_msgs::msg::Imu, sensor_msgs::msg::Temperature>>(
+    imu_subscriber_, temperature_subscriber_, 10);
+  synchronizer_->registerCallback(std::bind(&CalibrateImuTemp::imu_callback, this,
+                                            std::placeholders::_1, std::placeholders::_2));
+
+  // wait for data to arrive
+  rclcpp::Duration timeout(3, 0);
+  rclcpp::Time start = this->get_clock()->now();
+  while (((this->get_clock()->now() - start) < timeout) && first_time_ && rclcpp::ok()
+         && !interrupted_) {
+    rclcpp::spin_some(shared_from_this());
+  }
+
+  if (first_time_) {
+    RCLCPP_FATAL(this->get_logger(), "No messages on IMU topics, unable to calibrate");
+    calibrating_ = false;
+    restore_params(previous);
+    return;
+  }
+
+  while (calibrating_ && rclcpp::ok() && !interrupted_) {
+    rclcpp::spin_some(shared_from_this());
+  }
+
+  if (calibrating_) {
+    RCLCPP_WARN(this->get_logger(), "\rCalibration interrupted");
+    calibrating_ = false;
+    restore_params(previous);
+    return;
+  }
+
+  double span = max_temperature_ - min_temperature_;
+  if (span < MIN_TEMPERATURE_SPAN) {
+    RCLCPP_FATAL(this->get_logger(),
+                 "Temperature only changed by %.1f degrees, at least %.1f are needed to calibrate",
+                 span, MIN_TEMPERATURE_SPAN);
+    restore_params(previous);
+    return;
+  }
+  RCLCPP_INFO(this->get_logger(), "Fit %zu samples from %.1f to %.1f degrees, %zu rejected",
+              fits_[0].count(), min_temperature_, max_temperature_, num_rejected_);
+
+  // the fits are centered on the reference temperature, so shift the offsets back to zero degrees
+  std::vector<double> slopes;
+  std::vector<double> biases;
+  const char * axes[] = {"x", "y", "z"};
+  for (int i = 0; i < 6; i++) {
+    double slope = fits_[i].coefficients()(1);
+    double bias = fits_[i].coefficients()(0) - slope * reference_temperature_;
+    RCLCPP_INFO(this->get_logger(), "%s %s: bias %g + %g * temperature, residual %g",
+                i < 3 ? "accel" : "gyro", axes[i % 3], bias, slope, fits_[i].residual());
+    if (i < 3) {
+      slopes.push_back(slope);
+      biases.push_back(bias);
+    }
+  }
+
+  // set calibration parameters: temperature coefficients, then biases
+  std::vector<double> values = slopes;
+  values.insert(values.end(), biases.begin(), biases.end());
+  success = set_params(CALIBRATION_PARAMS, values);
+  if (!success) {
+    RCLCPP_ERROR(this->get_logger(), "Failed to set calibration parameters");
+    restore_params(previous);
+  }
+}
+
+void CalibrateImuTemp::imu_callback(
+  const sensor_msgs::msg::Imu::ConstSharedPtr & imu,
+  const sensor_msgs::msg::Temperature::ConstSharedPtr & temperature)
+{
+  if (!calibrating_) {
+    return;
+  }
+
+  double temp = temperature->temperature;
+  if (first_time_) {
+    first_time_ = false;
+    RCLCPP_WARN(this->get_logger(),
+                "Calibrating IMU temperature compensation, keep the vehicle level and still for "
+                "up to %g seconds!",
+                calibration_time_);
+    start_time_ = this->get_clock()->now().seconds();
+    reference_temperature_ = temp;
+    min_temperature_ = temp;
+    max_temperature_ = temp;
+  }
+
+  double elapsed = this->get_clock()->now().seconds() - start_time_;
+  printf("\r%.0f seconds remaining, %.1f to %.1f degrees  ", calibration_time_ - elapsed,
+         min_temperature_, max_temperature_);
+
+  // a rotating vehicle measures more than gravity
+  const auto & w = imu->angular_velocity;
+  if (w.x * w.x + w.y * w.y + w.z * w.z > max_gyro_rate_ * max_gyro_rate_) {
+    num_rejected_++;
+  } else {
+    min_temperature_ = std::min(min_temperature_, temp);
+    max_temperature_ = std::max(max_temperature_, temp);
+
+    // the bias is what is measured beyond gravity, with the vehicle level and still
+    const auto & a = imu->linear_acceleration;
+    double biases[6] = {a.x, a.y, a.z + GRAVITY, w.x, w.y, w.z};
+    RecursiveLeastSquares<2>::Vector x(1.0, temp - reference_temperature_);
+    for (int i = 0; i < 6; i++) { fits_[i].update(x, biases[i]); }
+  }
+
+  bool span_reached = temperature_span_ > 0.0
+    && max_temperature_ - min_temperature_ >= temperature_span_;
+  if (elapsed >= calibration_time_ || span_reached) {
+    RCLCPP_WARN(this->get_logger(), "\rdone!");
+    calibrating_ = false;
+  }
+}
+
+bool CalibrateImuTemp::set_params(const std::vector<std::string> & names,
+                                  const std::vector<double> & values)
+{
+  auto req = std::make_shared<rosflight_msgs::srv::ParamSetMany::Request>();
+  req->names = names;
+  req->values = values;
+
+  auto result = param_set_client_->async_send_request(req);
+
+  if (rclcpp::spin_until_future_complete(shared_from_this(), result, SERVICE_TIMEOUT)
+      == rclcpp::FutureReturnCode::SUCCESS) {
+    return result.get()->success;
+  } else {
+    param_set_client_->remove_pending_request(result);
+    return false;
+  }
+}
+
+bool CalibrateImuTemp::get_params(const std::vector<std::string> & names,
+                                  std::vector<double> * values)
+{
+  auto req = std::make_shared<rosflight_msgs::srv::ParamGetMany::Request>();
+  req->names = names;
+
+  auto result = param_get_client_->async_send_request(req);
+
+  if (rclcpp::spin_until_future_complete(shared_from_this(), result, SERVICE_TIMEOUT)
+      != rclcpp::FutureReturnCode::SUCCESS) {
+    param_get_client_->remove_pending_request(result);
+    return false;
+  }
+
+  auto response = result.get();
+  if (response->exists.size() != names.size() || response->values.size() != names.size()) {
+    return false;
+  }
+  for (bool exists : response->exists) {
+    if (!exists) {
+      return false;
+    }
+  }
+  *values = response->values;
+  return true;
+}
+
+void CalibrateImuTemp::restore_params(const std::vector<double> & values)
+{
+  if (set_params(CALIBRATION_PARAMS, values)) {
+    RCLCPP_INFO(this->get_logger(), "Restored the previous calibration parameters");
+    return;
+  }
+
+  // list the values, so they can be set by hand
+  RCLCPP_ERROR(this->get_logger(), "Failed to restore the previous calibration parameters:");
+  for (size_t i = 0; i < CALIBRATION_PARAMS.size(); i++) {
+    RCLCPP_ERROR(this->get_logger(), "  %s = %g", CALIBRATION_PARAMS[i].c_str(), values[i]);
+  }
+}
+
+} // namespace rosflight_io
@@ -0,0 +1,207 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file latency_tracker.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <algorithm>
+#include <numeric>
+
+#include <rosflight_io/latency_tracker.hpp>
+
+namespace rosflight_io
+{
+LatencyTracker::LatencyTracker(size_t window_size)
+    : window_size_(std::max(window_size, (size_t) 1))
+{
+  // 1-2-5 series from 10 us to 1 s, which covers everything from a local write to a stalled link
+  bin_edges_.push_back(0.0);
+  for (double decade = 1e-5; decade < 1.0; decade *= 10.0) {
+    bin_edges_.push_back(decade);
+    bin_edges_.push_back(2.0 * decade);
+    bin_edges_.push_back(5.0 * decade);
+  }
+  bin_edges_.push_back(1.0);
+}
+
+void LatencyTracker::command_received(const rclcpp::Time & header_stamp,
+                                      const rclcpp::Time & callback_time,
+                                      std::chrono::steady_clock::time_point callback_steady_time)
+{
+  CommandRecord record;
+  record.header_stamp = header_stamp;
+  record.callback_time = callback_time;
+  record.callback_steady_time = callback_steady_time;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (header_stamp.nanoseconds() != 0) {
+    add_sample(HEADER_TO_CALLBACK, (callback_time - header_stamp).seconds());
+  }
+
+  awaiting_write_.push_back(record);
+  if (awaiting_write_.size() > MAX_PENDING_COMMANDS) {
+    awaiting_write_.pop_front();
+  }
+}
+
+void LatencyTracker::command_written(std::chrono::steady_clock::time_point enqueue_time,
+                                     std::chrono::steady_clock::time_point write_time)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (awaiting_write_.empty()) {
+    return;
+  }
+
+  // A frame queued before the oldest traced command was received is an untraced resend
+  CommandRecord record = awaiting_write_.front();
+  if (enqueue_time < record.callback_steady_time) {
+    return;
+  }
+  awaiting_write_.pop_front();
+  record.enqueue_time = enqueue_time;
+  record.write_time = write_time;
+
+  add_sample(CALLBACK_TO_ENQUEUE,
+             std::chrono::duration<double>(enqueue_time - record.callback_steady_time).count());
+  add_sample(ENQUEUE_TO_WRITE, std::chrono::duration<double>(write_time - enqueue_time).count());
+
+  awaiting_response_.push_back(record);
+  if (awaiting_response_.size() > MAX_PENDING_COMMANDS) {
+    awaiting_response_.pop_front();
+  }
+}
+
+std::vector<rosflight_msgs::msg::CommandLatency> LatencyTracker::response_received()
+{
+  auto response_time = std::chrono::steady_clock::now();
+  std::vector<rosflight_msgs::msg::CommandLatency> completed;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const CommandRecord & record : awaiting_response_) {
+    add_sample(WRITE_TO_RESPONSE,
+               std::chrono::duration<double>(response_time - record.write_time).count());
+
+    rosflight_msgs::msg::CommandLatency msg;
+    msg.header.stamp = record.header_stamp;
+    msg.callback_time = record.callback_time;
+    msg.enqueue_time = to_ros_time(record, record.enqueue_time);
+    msg.write_time = to_ros_time(record, record.write_time);
+    msg.response_time = to_ros_time(record, response_time);
+
+    if (record.header_stamp.nanoseconds() != 0) {
+      add_sample(TOTAL, (rclcpp::Time(msg.response_time) - record.header_stamp).seconds());
+    }
+    completed.push_back(msg);
+  }
+  awaiting_response_.clear();
+
+  return completed;
+}
+
+std::vector<rosflight_msgs::msg::LatencyHistogram>
+LatencyTracker::get_histograms(const rclcpp::Time & stamp)
+{
+  std::vector<rosflight_msgs::msg::LatencyHistogram> histograms(NUM_STAGES);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int i = 0; i < NUM_STAGES; i++) {
+    rosflight_msgs::msg::LatencyHistogram & msg = histograms[i];
+    msg.header.stamp = stamp;
+    msg.stage = stage_name((Stage) i);
+    msg.bin_edges = bin_edges_;
+    msg.counts.assign(bin_edges_.size(), 0);
+
+    std::vector<double> samples(windows_[i].begin(), windows_[i].end());
+    msg.num_samples = samples.size();
+    if (samples.empty()) {
+      continue;
+    }
+
+    for (double sample : samples) {
+      // Index of the last edge at or below the sample
+      size_t bin = std::upper_bound(bin_edges_.begin(), bin_edges_.end(), sample)
+        - bin_edges_.begin();
+      msg.counts[bin > 0 ? bin - 1 : 0]++;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+      return samples[std::min((size_t) (p * samples.size()), samples.size() - 1)];
+    };
+    msg.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    msg.min = samples.front();
+    msg.max = samples.back();
+    msg.p50 = percentile(0.5);
+    msg.p90 = percentile(0.9);
+    msg.p99 = percentile(0.99);
+  }
+
+  return histograms;
+}
+
+const char * LatencyTracker::stage_name(Stage stage)
+{
+  switch (stage) {
+    case HEADER_TO_CALLBACK:
+      return "header_to_callback";
+    case CALLBACK_TO_ENQUEUE:
+      return "callback_to_enqueue";
+    case ENQUEUE_TO_WRITE:
+      return "enqueue_to_write";
+    case WRITE_TO_RESPONSE:
+      return "write_to_response";
+    case TOTAL:
+      return "total";
+    default:
+      return "unknown";
+  }
+}
+
+void LatencyTracker::add_sample(Stage stage, double latency)
+{
+  std::deque<double> & window = windows_[stage];
+  window.push_back(latency);
+  if (window.size() > window_size_) {
+    window.pop_front();
+  }
+}
+
+rclcpp::Time LatencyTracker::to_ros_time(const CommandRecord & record,
+                                         std::chrono::steady_clock::time_point time)
+{
+  return record.callback_time + rclcpp::Duration(time - record.callback_steady_time);
+}
+
+} // namespace rosflight_io
@@ -38,58 +38,116 @@
  * \author Devon Morris <devonmorris1992@gmail.com>
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include <cstdio>
+#include <limits>
+#include <mutex>
 #include <rosflight_io/mag_cal.hpp>
+#include <thread>
 
 namespace rosflight_io
 {
+namespace
+{
+/**
+ * @brief Pick k distinct random indices in [0, n) with Floyd's algorithm.
+ *
+ * Takes O(k^2) time regardless of n, and does not reorder the measurements.
+ */
+void sample_indices(size_t n, size_t k, std::mt19937 & generator, std::vector<size_t> & indices)
+{
+  indices.clear();
+  for (size_t j = n - k; j < n; j++) {
+    size_t t = std::uniform_int_distribution<size_t>(0, j)(generator);
+    if (std::find(indices.begin(), indices.end(), t) == indices.end()) {
+      indices.push_back(t);
+    } else {
+      indices.push_back(j);
+    }
+  }
+}
+} // namespace
+
 CalibrateMag::CalibrateMag()
-    : Node("calibrate_accel_temp")
+    : Node("calibrate_mag")
     , reference_field_strength_(1.0)
     , calibrating_(false)
     , first_time_(true)
     , start_time_(0)
-    , measurement_throttle_(0)
+    , scatter_count_(0)
+    , fit_residual_(-1.0)
+    , coverage_(0, 0)
+    , coverage_fit_(false)
 {
-  A_ = Eigen::MatrixXd::Zero(3, 3);
-  b_ = Eigen::MatrixXd::Zero(3, 1);
+  A_ = Eigen::Matrix3d::Zero();
+  b_ = Eigen::Vector3d::Zero();
   ransac_iters_ = 100;
   inlier_thresh_ = 200;
 
   this->declare_parameter("calibration_time", rclcpp::PARAMETER_DOUBLE);
-  this->declare_parameter("measurement_skip", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("ransac_threads", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("online_fit", rclcpp::PARAMETER_BOOL);
+  this->declare_parameter("fit_rate_hz", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("coverage_subdivisions", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("samples_per_bin", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("coverage_target", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("residual_target", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("batch_files", rclcpp::PARAMETER_STRING_ARRAY);
+  this->declare_parameter("batch_topic", rclcpp::PARAMETER_STRING);
+  this->declare_parameter("output_dir", rclcpp::PARAMETER_STRING);
+  this->declare_parameter("batch_threads", rclcpp::PARAMETER_INTEGER);
   calibration_time_ = this->get_parameter_or("calibration_time", 60.0);
-  measurement_skip_ = this->get_parameter_or("measurement_skip", 20);
-
-  param_set_client_ = this->create_client<rosflight_msgs::srv::ParamSet>("param_set");
+  ransac_threads_ = this->get_parameter_or("ransac_threads", 0);
+
+  // The online fit keeps a fixed size scatter matrix instead of every measurement, so captures
+  // can be arbitrarily long, but it can not reject outliers like RANSAC does
+  scatter_ = Matrix10d::Zero();
+  online_fit_ = this->get_parameter_or("online_fit", false);
+
+  // Subdivision level 2 has 162 bins, about 17 degrees apart
+  int subdivisions = this->get_parameter_or("coverage_subdivisions", 2);
+  int samples_per_bin = this->get_parameter_or("samples_per_bin", 10);
+  coverage_ = SphereCoverage(std::max(subdivisions, 0), std::max(samples_per_bin, 0));
+  coverage_target_ = this->get_parameter_or("coverage_target", 0.9);
+  residual_target_ = this->get_parameter_or("residual_target", 0.02);
+  coverage_A_ = Eigen::Matrix3d::Identity();
+  coverage_b_ = Eigen::Vector3d::Zero();
+
+  batch_files_ = this->get_parameter_or<std::vector<std::string>>("batch_files", {});
+  batch_topic_ = this->get_parameter_or<std::string>("batch_topic", "/magnetometer");
+  output_dir_ = this->get_parameter_or<std::string>("output_dir", ".");
+  batch_threads_ = this->get_parameter_or("batch_threads", 0);
+
+  double fit_rate = this->get_parameter_or("fit_rate_hz", 2.0);
+  calibration_pub_ = this->create_publisher<rosflight_msgs::msg::MagCalibration>(
+    "mag_calibration", 1);
+  fit_timer_ = this->create_wall_timer(
+    std::chrono::duration<double>(1.0 / std::max(fit_rate, 0.1)),
+    std::bind(&CalibrateMag::fit_timer_callback, this));
+
+  param_set_client_ = this->create_client<rosflight_msgs::srv::ParamSetMany>("param_set_many");
   mag_subscriber_.registerCallback(
     std::bind(&CalibrateMag::mag_callback, this, std::placeholders::_1));
 }
 
 void CalibrateMag::run()
 {
+  if (!batch_files_.empty()) {
+    run_batch();
+    return;
+  }
+
   // Subscribe to /magnetometer topic
   rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
   qos_profile.depth = 1;
   mag_subscriber_.subscribe(shared_from_this(), "/magnetometer", qos_profile);
 
-  // reset calibration parameters
-  bool success = true;
-  // reset soft iron parameters
-  success = success && set_param("MAG_A11_COMP", 1.0f);
-  success = success && set_param("MAG_A12_COMP", 0.0f);
-  success = success && set_param("MAG_A13_COMP", 0.0f);
-  success = success && set_param("MAG_A21_COMP", 0.0f);
-  success = success && set_param("MAG_A22_COMP", 1.0f);
-  success = success && set_param("MAG_A23_COMP", 0.0f);
-  success = success && set_param("MAG_A31_COMP", 0.0f);
-  success = success && set_param("MAG_A32_COMP", 0.0f);
-  success = success && set_param("MAG_A33_COMP", 1.0f);
-
-  // reset hard iron parameters
-  success = success && set_param("MAG_X_BIAS", 0.0f);
-  success = success && set_param("MAG_Y_BIAS", 0.0f);
-  success = success && set_param("MAG_Z_BIAS", 0.0f);
+  // reset calibration parameters: soft iron, then hard iron
+  bool success = set_params(CALIBRATION_PARAMS, {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0,
+                                                 0.0, 0.0, 0.0});
 
   if (!success) {
     RCLCPP_FATAL(this->get_logger(), "Failed to reset calibration parameters");
@@ -116,24 +174,17 @@ void CalibrateMag::run()
 
   if (!calibrating_) {
     // compute calibration
-    do_mag_calibration();
-
-    // set calibration parameters
-    // set soft iron parameters
-    success = success && set_param("MAG_A11_COMP", a11());
-    success = success && set_param("MAG_A12_COMP", a12());
-    success = success && set_param("MAG_A13_COMP", a13());
-    success = success && set_param("MAG_A21_COMP", a21());
-    success = success && set_param("MAG_A22_COMP", a22());
-    success = success && set_param("MAG_A23_COMP", a23());
-    success = success && set_param("MAG_A31_COMP", a31());
-    success = success && set_param("MAG_A32_COMP", a32());
-    success = success && set_param("MAG_A33_COMP", a33());
-
-    // set hard iron parameters
-    success = success && set_param("MAG_X_BIAS", bx());
-    success = success && set_param("MAG_Y_BIAS", by());
-    success = success && set_param("MAG_Z_BIAS", bz());
+    if (!do_mag_calibration()) {
+      RCLCPP_FATAL(this->get_logger(), "Failed to fit an ellipsoid to the measurements");
+      return;
+    }
+
+    // set calibration parameters: soft iron, then hard iron
+    success = set_params(CALIBRATION_PARAMS, {a11(), a12(), a13(), a21(), a22(), a23(), a31(),
+                                              a32(), a33(), bx(), by(), bz()});
+    if (!success) {
+      RCLCPP_ERROR(this->get_logger(), "Failed to set calibration parameters");
+    }
   }
 }
 
@@ -146,18 +197,83 @@ void CalibrateMag::start_mag_calibration()
 
   measurement_prev_ = Eigen::Vector3d::Zero();
   measurements_.clear();
+  scatter_ = Matrix10d::Zero();
+  scatter_count_ = 0;
+  fit_residual_ = -1.0;
+  coverage_.reset();
+  coverage_fit_ = false;
 }
 
-void CalibrateMag::do_mag_calibration()
+bool CalibrateMag::do_mag_calibration()
 {
-  // fit ellipsoid to measurements according to Li paper but in RANSAC form
-  RCLCPP_INFO(this->get_logger(), "Collected %u measurements. Fitting ellipsoid.",
-              (uint32_t) measurements_.size());
-  Eigen::MatrixXd u = ellipsoidRANSAC(measurements_, ransac_iters_, inlier_thresh_);
+  Vector10d u;
+  if (online_fit_) {
+    // fit ellipsoid to all measurements according to Li paper
+    RCLCPP_INFO(this->get_logger(), "Collected %zu measurements. Fitting ellipsoid.",
+                scatter_count_);
+    u = ellipsoidLS(scatter_);
+  } else {
+    // fit ellipsoid to measurements according to Li paper but in RANSAC form
+    RCLCPP_INFO(this->get_logger(), "Collected %u measurements. Fitting ellipsoid.",
+                (uint32_t) measurements_.size());
+    u = ellipsoidRANSAC(measurements_, ransac_iters_, inlier_thresh_);
+  }
+
+  Ellipsoid ellipsoid;
+  if (!toEllipsoid(u, ellipsoid)) {
+    return false;
+  }
 
   // magnetometer calibration parameters according to Renaudin paper
   RCLCPP_INFO(this->get_logger(), "Computing calibration parameters.");
   magCal(u, A_, b_);
+  return A_.allFinite() && b_.allFinite();
+}
+
+void CalibrateMag::fit_timer_callback()
+{
+  if (!calibrating_ || scatter_count_ < RANSAC_SAMPLE_SIZE) {
+    return;
+  }
+
+  // the fit is not an ellipsoid until the measurements cover enough directions
+  Vector10d u = ellipsoidLS(scatter_);
+  Ellipsoid ellipsoid;
+  if (!toEllipsoid(u, ellipsoid)) {
+    return;
+  }
+
+  Eigen::Matrix3d A;
+  Eigen::Vector3d b;
+  magCal(u, A, b);
+  if (!A.allFinite() || !b.allFinite()) {
+    return;
+  }
+  fit_residual_ = fitResidual(u, ellipsoid, scatter_, scatter_count_);
+
+  // measurements are only binned once a fit is close enough to tell their direction
+  if (fit_residual_ < COVERAGE_FIT_RESIDUAL) {
+    coverage_A_ = A;
+    coverage_b_ = b;
+    coverage_fit_ = true;
+  }
+
+  rosflight_msgs::msg::MagCalibration msg;
+  msg.header.stamp = this->get_clock()->now();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) { msg.soft_iron[3 * i + j] = A(i, j); }
+    msg.hard_iron[i] = b(i);
+  }
+  msg.residual = fit_residual_;
+  msg.num_measurements = scatter_count_;
+  msg.coverage = coverage_.coverage();
+  calibration_pub_->publish(msg);
+
+  if (msg.coverage >= coverage_target_ && fit_residual_ <= residual_target_) {
+    RCLCPP_WARN(this->get_logger(), "\rdone! Covered %.0f%% of orientations in %.1f seconds",
+                100.0 * msg.coverage, this->get_clock()->now().seconds() - start_time_);
+    calibrating_ = false;
+  }
 }
 
 bool CalibrateMag::mag_callback(const sensor_msgs::msg::MagneticField::ConstSharedPtr & mag)
@@ -172,20 +288,32 @@ bool CalibrateMag::mag_callback(const sensor_msgs::msg::MagneticField::ConstShar
 
     double elapsed = this->get_clock()->now().seconds() - start_time_;
 
-    printf("\r%.1f seconds remaining", calibration_time_ - elapsed);
+    if (fit_residual_ >= 0.0) {
+      printf("\r%.1f seconds remaining, coverage %.0f%%, fit residual %.2f%%  ",
+             calibration_time_ - elapsed, 100.0 * coverage_.coverage(), 100.0 * fit_residual_);
+    } else {
+      printf("\r%.1f seconds remaining", calibration_time_ - elapsed);
+    }
 
     // if still in calibration mode
     if (elapsed < calibration_time_) {
-      if (measurement_throttle_ > measurement_skip_) {
-        Eigen::Vector3d measurement;
-        measurement << mag->magnetic_field.x, mag->magnetic_field.y, mag->magnetic_field.z;
+      Eigen::Vector3d measurement;
+      measurement << mag->magnetic_field.x, mag->magnetic_field.y, mag->magnetic_field.z;
+
+      // until there is a fit to find their direction with, every new measurement is kept
+      bool keep = measurement != measurement_prev_;
+      if (keep && coverage_fit_) {
+        keep = coverage_.add(coverage_A_ * (measurement - coverage_b_));
+      }
 
-        if (measurement != measurement_prev_) {
+      if (keep) {
+        addToScatter(measurement, scatter_);
+        scatter_count_++;
+        if (!online_fit_) {
           measurements_.push_back(measurement);
         }
-        measurement_prev_ = measurement;
       }
-      measurement_throttle_++;
+      measurement_prev_ = measurement;
     } else {
       RCLCPP_WARN(this->get_logger(), "\rdone!");
       calibrating_ = false;
@@ -195,102 +323,94 @@ bool CalibrateMag::mag_callback(const sensor_msgs::msg::MagneticField::ConstShar
   return true;
 }
 
-Eigen::MatrixXd CalibrateMag::ellipsoidRANSAC(EigenSTL::vector_Vector3d meas, int iters,
-                                              double inlier_thresh)
+CalibrateMag::Vector10d CalibrateMag::ellipsoidRANSAC(const EigenSTL::vector_Vector3d & meas,
+                                                      int iters, double inlier_thresh)
 {
-  // initialize random number generator
-  std::random_device random_dev;
-  std::mt19937 generator(random_dev());
-
-  // RANSAC to find a good ellipsoid fit
-  int inlier_count_best = 0;              // number of inliers for best fit
-  EigenSTL::vector_Vector3d inliers_best; // container for inliers to best fit
-  double dist_sum = 0; // sum distances of all measurements from ellipsoid surface
-  int dist_count = 0;  // count number distances of all measurements from ellipsoid surface
-  for (unsigned i = 0; i < (unsigned) iters; i++) {
-    // pick 9 random, unique measurements by shuffling measurements
-    // and grabbing the first 9
-    std::shuffle(meas.begin(), meas.end(), generator);
-    EigenSTL::vector_Vector3d meas_sample;
-    for (unsigned j = 0; j < 9; j++) {
-      meas_sample.push_back(meas[j]);
-    }
+  size_t n = meas.size();
+  if (n < RANSAC_SAMPLE_SIZE) {
+    RCLCPP_ERROR(this->get_logger(), "Too few measurements for RANSAC, fitting all of them.");
+    Matrix10d DDt = Matrix10d::Zero();
+    for (const auto & item : meas) { addToScatter(item, DDt); }
+    return ellipsoidLS(DDt);
+  }
 
-    // fit ellipsoid to 9 random points
-    Eigen::MatrixXd u = ellipsoidLS(meas_sample);
-
-    // check if LS fit is actually an ellipsoid (paragraph of Li following eq. 2-4)
-    // unpack needed parts of u
-    double a = u(0);
-    double b = u(1);
-    double c = u(2);
-    double f = u(3);
-    double g = u(4);
-    double h = u(5);
-    double p = u(6);
-    double q = u(7);
-    double r = u(8);
-    double d = u(9);
-
-    double I = a + b + c;
-    double J = a * b + b * c + a * c - f * f - g * g - h * h;
-
-    if (4 * J - I * I <= 0) {
-      continue;
-    }
+  unsigned num_threads = ransac_threads_ > 0 ? ransac_threads_
+                                             : std::thread::hardware_concurrency();
+  num_threads = std::max(1u, std::min(num_threads, (unsigned) std::max(iters, 1)));
+
+  // shared RANSAC state, the iteration limit is lowered as better hypotheses are found
+  std::atomic<int> next_iter(0);
+  std::atomic<int> max_iters(iters);
+  std::mutex best_mutex;
+  int inlier_count_best = 0; // number of inliers for best fit
+  Ellipsoid ellipsoid_best;  // best fit
+  double dist_sum = 0;       // sum distances of all measurements from ellipsoid surface
+  size_t dist_count = 0;     // count number distances of all measurements from ellipsoid surface
+  int hypotheses = 0;        // number of samples that were fit
+
+  auto worker = [&](unsigned seed) {
+    std::mt19937 generator(seed);
+    std::vector<size_t> sample;
+    double thread_dist_sum = 0;
+    size_t thread_dist_count = 0;
+    int thread_hypotheses = 0;
+
+    while (next_iter++ < max_iters) {
+      // fit ellipsoid to 9 random, unique measurements
+      sample_indices(n, RANSAC_SAMPLE_SIZE, generator, sample);
+      Matrix10d DDt = Matrix10d::Zero();
+      for (size_t index : sample) { addToScatter(meas[index], DDt); }
+      thread_hypotheses++;
+
+      // check if LS fit is actually an ellipsoid (paragraph of Li following eq. 2-4)
+      Ellipsoid ellipsoid;
+      if (!toEllipsoid(ellipsoidLS(DDt), ellipsoid)) {
+        continue;
+      }
+
+      // count inliers
+      int inlier_count = 0;
+      for (const auto & item : meas) {
+        double dist = surfaceDistance(item, ellipsoid);
+        thread_dist_sum += dist;
+        thread_dist_count++;
 
-    // eq. 15 of Renaudin and eqs. 1 and 4 of Li
-    Eigen::MatrixXd Q(3, 3);
-    Q << a, h, g, h, b, f, g, f, c;
-
-    Eigen::MatrixXd ub(3, 1);
-    ub << 2 * p, 2 * q, 2 * r;
-    double k = d;
-
-    // eq. 21 of Renaudin (should be negative according to eq. 16)
-    // this is the vector to the ellipsoid center
-    Eigen::MatrixXd bb = -0.5 * (Q.inverse() * ub);
-    Eigen::Vector3d r_e;
-    r_e << bb(0), bb(1), bb(2);
-
-    // count inliers and store inliers
-    int inlier_count = 0;
-    EigenSTL::vector_Vector3d inliers;
-    for (auto & item : meas) {
-      // compute the vector from ellipsoid center to surface along
-      // measurement vector and a one from the perturbed measurement
-      Eigen::Vector3d perturb = Eigen::Vector3d::Ones() * 0.1;
-      Eigen::Vector3d r_int = intersect(item, r_e, Q, ub, k);
-      Eigen::Vector3d r_int_prime = intersect(item + perturb, r_e, Q, ub, k);
-
-      // now compute the vector normal to the surface
-      Eigen::Vector3d r_align = r_int_prime - r_int;
-      Eigen::Vector3d r_normal = r_align.cross(r_int.cross(r_int_prime));
-      Eigen::Vector3d i_normal = r_normal / r_normal.norm();
-
-      // get vector from surface to measurement and take dot product
-      // with surface normal vector to find distance from ellipsoid fit
-      Eigen::Vector3d r_sm = item - r_e - r_int;
-      double dist = r_sm.dot(i_normal);
-      dist_sum += dist;
-      dist_count++;
-
-      // check measurement distance against inlier threshold
-      if (fabs(dist) < inlier_thresh) {
-        inliers.push_back(item);
-        inlier_count++;
+        // check measurement distance against inlier threshold
+        if (std::abs(dist) < inlier_thresh) {
+          inlier_count++;
+        }
       }
-    }
 
-    // save best inliers and their count
-    if (inlier_count > inlier_count_best) {
-      inliers_best.clear();
-      for (const auto & item : inliers) {
-        inliers_best.push_back(item);
+      // save best fit, and stop once enough iterations have run for its inlier ratio
+      std::lock_guard<std::mutex> lock(best_mutex);
+      if (inlier_count > inlier_count_best) {
+        inlier_count_best = inlier_count;
+        ellipsoid_best = ellipsoid;
+        max_iters = std::min(iters, ransacIterations((double) inlier_count / n));
       }
-      inlier_count_best = inlier_count;
     }
+
+    std::lock_guard<std::mutex> lock(best_mutex);
+    dist_sum += thread_dist_sum;
+    dist_count += thread_dist_count;
+    hypotheses += thread_hypotheses;
+  };
+
+  // each thread gets its own generator, seeded separately
+  std::random_device random_dev;
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < num_threads; i++) { threads.emplace_back(worker, random_dev()); }
+  worker(random_dev());
+  for (auto & thread : threads) { thread.join(); }
+
+  if (inlier_count_best == 0) {
+    RCLCPP_ERROR(this->get_logger(), "RANSAC found no ellipsoid, fitting all measurements.");
+    Matrix10d DDt = Matrix10d::Zero();
+    for (const auto & item : meas) { addToScatter(item, DDt); }
+    return ellipsoidLS(DDt);
   }
+  RCLCPP_INFO(this->get_logger(), "RANSAC ran %d iterations on %u threads, %d of %zu inliers.",
+              hypotheses, num_threads, inlier_count_best, n);
 
   // check average measurement distance from surface
   double dist_avg = dist_sum / dist_count;
@@ -304,24 +424,71 @@ Eigen::MatrixXd CalibrateMag::ellipsoidRANSAC(EigenSTL::vector_Vector3d meas, in
   }
 
   // perform LS on set of best inliers
-  Eigen::MatrixXd u_final = ellipsoidLS(inliers_best);
+  Matrix10d DDt = Matrix10d::Zero();
+  for (const auto & item : meas) {
+    if (std::abs(surfaceDistance(item, ellipsoid_best)) < inlier_thresh) {
+      addToScatter(item, DDt);
+    }
+  }
+  return ellipsoidLS(DDt);
+}
+
+int CalibrateMag::ransacIterations(double inlier_ratio)
+{
+  double p_good_sample = std::pow(inlier_ratio, RANSAC_SAMPLE_SIZE);
+  if (p_good_sample <= 0.0) {
+    return INT_MAX;
+  } else if (p_good_sample >= 1.0) {
+    return 1;
+  }
+  double iters = std::ceil(std::log(1.0 - RANSAC_CONFIDENCE) / std::log(1.0 - p_good_sample));
+  return iters < INT_MAX ? (int) iters : INT_MAX;
+}
+
+bool CalibrateMag::toEllipsoid(const Vector10d & u, Ellipsoid & ellipsoid)
+{
+  // unpack coefficients
+  double a = u(0);
+  double b = u(1);
+  double c = u(2);
+  double f = u(3);
+  double g = u(4);
+  double h = u(5);
+  double p = u(6);
+  double q = u(7);
+  double r = u(8);
+  double d = u(9);
+
+  // eq. 15 of Renaudin and eqs. 1 and 4 of Li
+  ellipsoid.Q << a, h, g, h, b, f, g, f, c;
+  ellipsoid.ub << 2 * p, 2 * q, 2 * r;
+  ellipsoid.k = d;
+
+  // eq. 21 of Renaudin (should be negative according to eq. 16)
+  // this is the vector to the ellipsoid center
+  ellipsoid.center = -0.5 * (ellipsoid.Q.inverse() * ellipsoid.ub);
 
-  return u_final;
+  // check if the fit is actually an ellipsoid (paragraph of Li following eq. 2-4)
+  double I = a + b + c;
+  double J = a * b + b * c + a * c - f * f - g * g - h * h;
+  return 4 * J - I * I > 0;
 }
 
-Eigen::Vector3d CalibrateMag::intersect(const Eigen::Vector3d & r_m, const Eigen::Vector3d & r_e,
-                                        const Eigen::MatrixXd & Q, const Eigen::MatrixXd & ub,
-                                        const double k)
+Eigen::Vector3d CalibrateMag::intersect(const Eigen::Vector3d & r_m, const Ellipsoid & ellipsoid)
 {
+  const Eigen::Matrix3d & Q = ellipsoid.Q;
+  const Eigen::Vector3d & ub = ellipsoid.ub;
+  const Eigen::Vector3d & r_e = ellipsoid.center;
+
   // form unit vector from ellipsoid center (r_e) pointing to measurement
-  Eigen::Vector3d r_em = r_m - r_e;
-  Eigen::Vector3d i_em = r_em / r_em.norm();
+  Eigen::Vector3d i_em = (r_m - r_e).normalized();
 
   // solve quadratic equation for alpha, which determines how much to scale
   // i_em to intersect the ellipsoid surface (this is in Jerel's notebook)
-  double A = (i_em.transpose() * Q * i_em)(0);
-  double B = (2 * (i_em.transpose() * Q * r_e + ub.transpose() * i_em))(0);
-  double C = (ub.transpose() * r_e + r_e.transpose() * Q * r_e)(0) + k;
+  Eigen::Vector3d Q_i_em = Q * i_em;
+  double A = i_em.dot(Q_i_em);
+  double B = 2 * (Q_i_em.dot(r_e) + ub.dot(i_em));
+  double C = ub.dot(r_e) + r_e.dot(Q * r_e) + ellipsoid.k;
   double alpha = (-B + sqrt(B * B - 4 * A * C)) / (2 * A);
 
   // compute vector from ellipsoid center to its surface along measurement vector
@@ -330,167 +497,129 @@ Eigen::Vector3d CalibrateMag::intersect(const Eigen::Vector3d & r_m, const Eigen
   return r_int;
 }
 
-void CalibrateMag::eigSort(Eigen::MatrixXd & w, Eigen::MatrixXd & v)
+double CalibrateMag::surfaceDistance(const Eigen::Vector3d & r_m, const Ellipsoid & ellipsoid)
 {
-  // create index array
-  int idx[w.cols()];
-  for (int i = 0; i < w.cols(); i++) {
-    idx[i] = i;
-  }
-
-  // do a bubble sort and keep track of where values go with the index array
-  int has_changed = 1; // true
-  Eigen::MatrixXd w_sort = w;
-  while (has_changed == 1) {
-    has_changed = 0; // false
-    for (unsigned i = 0; i < w.cols() - 1; i++) {
-      if (w_sort(i) < w_sort(i + 1)) {
-        // switch values
-        double temp_d = w_sort(i);
-        w_sort(i) = w_sort(i + 1);
-        w_sort(i + 1) = temp_d;
-
-        // switch indices
-        int temp_i = idx[i];
-        idx[i] = idx[i + 1];
-        idx[i + 1] = temp_i;
-
-        has_changed = 1; // true
-      }
-    }
-  }
-
-  // add sorted eigenvalues/eigenvectors to output
-  Eigen::MatrixXd w1 = w;
-  Eigen::MatrixXd v1 = v;
-  for (unsigned i = 0; i < w.cols(); i++) {
-    w1(i) = w(idx[i]);
-    v1.col(i) = v.col(idx[i]);
-  }
-  w = w1;
-  v = v1;
+  // compute the vector from ellipsoid center to surface along
+  // measurement vector and a one from the perturbed measurement
+  Eigen::Vector3d perturb = Eigen::Vector3d::Constant(0.1);
+  Eigen::Vector3d r_int = intersect(r_m, ellipsoid);
+  Eigen::Vector3d r_int_prime = intersect(r_m + perturb, ellipsoid);
+
+  // now compute the vector normal to the surface
+  Eigen::Vector3d r_align = r_int_prime - r_int;
+  Eigen::Vector3d i_normal = r_align.cross(r_int.cross(r_int_prime)).normalized();
+
+  // get vector from surface to measurement and take dot product
+  // with surface normal vector to find distance from ellipsoid fit
+  Eigen::Vector3d r_sm = r_m - ellipsoid.center - r_int;
+  return r_sm.dot(i_normal);
 }
 
-Eigen::MatrixXd CalibrateMag::ellipsoidLS(EigenSTL::vector_Vector3d meas)
+void CalibrateMag::addToScatter(const Eigen::Vector3d & meas, Matrix10d & DDt)
 {
-  // form D matrix from eq. 6
-  Eigen::MatrixXd D(10, meas.size());
-  for (unsigned i = 0; i < D.cols(); i++) {
-    // unpack measurement components
-    double x = meas[i](0);
-    double y = meas[i](1);
-    double z = meas[i](2);
-
-    // fill in the D matrix
-    D(0, i) = x * x;
-    D(1, i) = y * y;
-    D(2, i) = z * z;
-    D(3, i) = 2 * y * z;
-    D(4, i) = 2 * x * z;
-    D(5, i) = 2 * x * y;
-    D(6, i) = 2 * x;
-    D(7, i) = 2 * y;
-    D(8, i) = 2 * z;
-    D(9, i) = 1;
-  }
+  // unpack measurement components
+  double x = meas(0);
+  double y = meas(1);
+  double z = meas(2);
+
+  // column of the D matrix from eq. 6
+  Vector10d D;
+  D << x * x, y * y, z * z, 2 * y * z, 2 * x * z, 2 * x * y, 2 * x, 2 * y, 2 * z, 1;
+  DDt.noalias() += D * D.transpose();
+}
 
-  // form the C1 matrix from eq. 7
-  double k = 4;
-  Eigen::MatrixXd C1 = Eigen::MatrixXd::Zero(6, 6);
-  C1(0, 0) = -1;
-  C1(0, 1) = k / 2 - 1;
-  C1(0, 2) = k / 2 - 1;
-  C1(1, 0) = k / 2 - 1;
-  C1(1, 1) = -1;
-  C1(1, 2) = k / 2 - 1;
-  C1(2, 0) = k / 2 - 1;
-  C1(2, 1) = k / 2 - 1;
-  C1(2, 2) = -1;
-  C1(3, 3) = -k;
-  C1(4, 4) = -k;
-  C1(5, 5) = -k;
+CalibrateMag::Vector10d CalibrateMag::ellipsoidLS(const Matrix10d & DDt)
+{
+  typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+  typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+  // form the C1 matrix from eq. 7, it is constant so only its inverse is kept
+  static const Matrix6d C1_inv = [] {
+    double k = 4;
+    Matrix6d C1 = Matrix6d::Zero();
+    C1(0, 0) = -1;
+    C1(0, 1) = k / 2 - 1;
+    C1(0, 2) = k / 2 - 1;
+    C1(1, 0) = k / 2 - 1;
+    C1(1, 1) = -1;
+    C1(1, 2) = k / 2 - 1;
+    C1(2, 0) = k / 2 - 1;
+    C1(2, 1) = k / 2 - 1;
+    C1(2, 2) = -1;
+    C1(3, 3) = -k;
+    C1(4, 4) = -k;
+    C1(5, 5) = -k;
+    return Matrix6d(C1.inverse());
+  }();
 
   // decompose D*D^T according to eq. 11
-  Eigen::MatrixXd DDt = D * D.transpose();
-  Eigen::MatrixXd S11 = DDt.block(0, 0, 6, 6);
-  Eigen::MatrixXd S12 = DDt.block(0, 6, 6, 4);
-  Eigen::MatrixXd S22 = DDt.block(6, 6, 4, 4);
+  Matrix6d S11 = DDt.topLeftCorner<6, 6>();
+  Eigen::Matrix<double, 6, 4> S12 = DDt.topRightCorner<6, 4>();
+  Eigen::Matrix4d S22_inv = DDt.bottomRightCorner<4, 4>().inverse();
 
   // solve eigensystem in eq. 15
-  Eigen::MatrixXd ES = C1.inverse() * (S11 - S12 * S22.inverse() * S12.transpose());
-  Eigen::EigenSolver<Eigen::MatrixXd> eigensolver(ES);
+  Matrix6d ES = C1_inv * (S11 - S12 * S22_inv * S12.transpose());
+  Eigen::EigenSolver<Matrix6d> eigensolver(ES);
   if (eigensolver.info() != Eigen::Success) {
-    abort();
+    return Vector10d::Constant(std::numeric_limits<double>::quiet_NaN());
   }
-  Eigen::MatrixXd w = eigensolver.eigenvalues().real().transpose();
-  Eigen::MatrixXd V = eigensolver.eigenvectors().real();
-
-  // sort eigenvalues and eigenvectors from most positive to most negative
-  eigSort(w, V);
 
-  // compute solution vector defined in paragraph below eq. 15
-  Eigen::MatrixXd u1 = V.col(0);
-  Eigen::MatrixXd u2 = -(S22.inverse() * S12.transpose() * u1);
-  Eigen::MatrixXd u(10, 1);
-  u.block(0, 0, 6, 1) = u1;
-  u.block(6, 0, 4, 1) = u2;
+  // the solution is the eigenvector of the most positive eigenvalue (paragraph below eq. 15)
+  Eigen::Index max_index;
+  eigensolver.eigenvalues().real().maxCoeff(&max_index);
+  Vector6d u1 = eigensolver.eigenvectors().col(max_index).real();
 
+  Vector10d u;
+  u << u1, -(S22_inv * S12.transpose() * u1);
   return u;
 }
 
-void CalibrateMag::magCal(Eigen::MatrixXd u, Eigen::MatrixXd & A, Eigen::MatrixXd & bb) const
+double CalibrateMag::fitResidual(const Vector10d & u, const Ellipsoid & ellipsoid,
+                                 const Matrix10d & DDt, size_t count)
 {
-  // unpack coefficients
-  double a = u(0);
-  double b = u(1);
-  double c = u(2);
-  double f = u(3);
-  double g = u(4);
-  double h = u(5);
-  double p = u(6);
-  double q = u(7);
-  double r = u(8);
-  double d = u(9);
-
-  // compute Q, u, and k according to eq. 15 of Renaudin and eqs. 1 and 4 of Li
-  Eigen::MatrixXd Q(3, 3);
-  Q << a, h, g, h, b, f, g, f, c;
-
-  Eigen::MatrixXd ub(3, 1);
-  ub << 2 * p, 2 * q, 2 * r;
-  double k = d;
+  // constant of the ellipsoid equation in centered form, (x - c)^T Q (x - c) = rho
+  double rho = ellipsoid.center.dot(ellipsoid.Q * ellipsoid.center) - ellipsoid.k;
+  double sum_squares = std::max(u.dot(DDt * u), 0.0);
+  return 0.5 * std::sqrt(sum_squares / count) / std::abs(rho);
+}
 
-  // extract bb according to eq. 21 of Renaudin (should be negative according to eq. 16)
-  bb = -0.5 * (Q.inverse() * ub);
+void CalibrateMag::magCal(const Vector10d & u, Eigen::Matrix3d & A, Eigen::Vector3d & bb) const
+{
+  // compute Q, u, and k according to eq. 15 of Renaudin and eqs. 1 and 4 of Li, and extract bb
+  // according to eq. 21 of Renaudin (should be negative according to eq. 16)
+  Ellipsoid ellipsoid;
+  toEllipsoid(u, ellipsoid);
+  bb = ellipsoid.center;
 
   // eigendecomposition of Q according to eq. 22 of Renaudin
-  Eigen::EigenSolver<Eigen::MatrixXd> eigensolver(Q);
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigensolver(ellipsoid.Q);
   if (eigensolver.info() != Eigen::Success) {
     abort();
   }
-  Eigen::MatrixXd D = eigensolver.eigenvalues().real().asDiagonal();
-  Eigen::MatrixXd V = eigensolver.eigenvectors().real();
+  Eigen::Matrix3d D = eigensolver.eigenvalues().asDiagonal();
+  Eigen::Matrix3d V = eigensolver.eigenvectors();
 
   // compute alpha according to eq. 27 of Renaudin (the denominator needs to be multiplied by -1)
   double Hm = reference_field_strength_; // (uT) Provo, UT magnetic field magnitude
-  Eigen::MatrixXd utVDiVtu = ub.transpose() * V * D.inverse() * V.transpose() * ub;
-  double alpha = (4. * Hm * Hm) / (utVDiVtu(0) - 4 * k);
+  double utVDiVtu = ellipsoid.ub.dot(V * D.inverse() * V.transpose() * ellipsoid.ub);
+  double alpha = (4. * Hm * Hm) / (utVDiVtu - 4 * ellipsoid.k);
 
   // now compute A from eq. 8 and 28 of Renaudin
   A = V * (alpha * D).cwiseSqrt() * V.transpose();
 }
 
-bool CalibrateMag::set_param(std::string name, double value)
+bool CalibrateMag::set_params(const std::vector<std::string> & names,
+                              const std::vector<double> & values)
 {
-  auto req = std::make_shared<rosflight_msgs::srv::ParamSet::Request>();
-  req->name = std::move(name);
-  req->value = value;
+  auto req = std::make_shared<rosflight_msgs::srv::ParamSetMany::Request>();
+  req->names = names;
+  req->values = values;
 
   auto result = param_set_client_->async_send_request(req);
 
   if (rclcpp::spin_until_future_complete(shared_from_this(), result)
       == rclcpp::FutureReturnCode::SUCCESS) {
-    return result.get()->exists;
+    return result.get()->success;
   } else {
     return false;
   }
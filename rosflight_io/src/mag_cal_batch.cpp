@@ -0,0 +1,298 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file mag_cal_batch.cpp
+ * \author agent <agent@local>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <thread>
+
+#include <rclcpp/serialization.hpp>
+#include <rosbag2_cpp/reader.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include <rosflight_io/mag_cal.hpp>
+#include <rosflight_io/mavrosflight/mavlink_bridge.hpp>
+
+namespace rosflight_io
+{
+void CalibrateMag::run_batch()
+{
+  std::error_code error;
+  std::filesystem::create_directories(output_dir_, error);
+
+  // name each parameter file after its capture, numbering captures that share a name
+  std::vector<BatchResult> results(batch_files_.size());
+  std::set<std::string> output_names;
+  for (size_t i = 0; i < batch_files_.size(); i++) {
+    std::filesystem::path path = std::filesystem::path(batch_files_[i]).lexically_normal();
+    if (!path.has_filename()) {
+      path = path.parent_path();
+    }
+    std::string name = path.stem().string();
+    for (int n = 2; output_names.count(name) > 0; n++) {
+      name = path.stem().string() + "_" + std::to_string(n);
+    }
+    output_names.insert(name);
+
+    results[i].file = batch_files_[i];
+    results[i].output = (std::filesystem::path(output_dir_) / (name + "_mag_cal.yaml")).string();
+    results[i].success = false;
+  }
+
+  // fit captures in parallel, running each RANSAC on a single thread so the cores are not
+  // oversubscribed
+  unsigned num_threads = batch_threads_ > 0 ? batch_threads_ : std::thread::hardware_concurrency();
+  num_threads = std::max(1u, std::min(num_threads, (unsigned) results.size()));
+  if (num_threads > 1) {
+    ransac_threads_ = 1;
+  }
+
+  std::atomic<size_t> next_file(0);
+  auto worker = [&]() {
+    for (size_t i = next_file++; i < results.size(); i = next_file++) {
+      BatchResult & result = results[i];
+      if (calibrate_capture(result.file, result) && writeParamFile(result)) {
+        RCLCPP_INFO(this->get_logger(), "%s: residual %.2f%%, coverage %.0f%%, wrote %s",
+                    result.file.c_str(), 100.0 * result.residual, 100.0 * result.coverage,
+                    result.output.c_str());
+      } else {
+        result.success = false;
+        RCLCPP_ERROR(this->get_logger(), "%s: calibration failed", result.file.c_str());
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < num_threads; t++) { threads.emplace_back(worker); }
+  worker();
+  for (std::thread & thread : threads) { thread.join(); }
+
+  // summary of every capture, for comparing calibrations across vehicles
+  YAML::Emitter yaml;
+  yaml << YAML::BeginSeq;
+  size_t num_succeeded = 0;
+  for (const BatchResult & result : results) {
+    yaml << YAML::BeginMap;
+    yaml << YAML::Key << "file" << YAML::Value << result.file;
+    yaml << YAML::Key << "success" << YAML::Value << result.success;
+    if (result.success) {
+      num_succeeded++;
+      yaml << YAML::Key << "output" << YAML::Value << result.output;
+      yaml << YAML::Key << "num_measurements" << YAML::Value << result.num_measurements;
+      yaml << YAML::Key << "num_inliers" << YAML::Value << result.num_inliers;
+      yaml << YAML::Key << "residual" << YAML::Value << result.residual;
+      yaml << YAML::Key << "coverage" << YAML::Value << result.coverage;
+      yaml << YAML::Key << "soft_iron" << YAML::Value << YAML::Flow << YAML::BeginSeq;
+      for (int i = 0; i < 9; i++) { yaml << result.A(i / 3, i % 3); }
+      yaml << YAML::EndSeq;
+      yaml << YAML::Key << "hard_iron" << YAML::Value << YAML::Flow << YAML::BeginSeq;
+      for (int i = 0; i < 3; i++) { yaml << result.b(i); }
+      yaml << YAML::EndSeq;
+    }
+    yaml << YAML::EndMap;
+  }
+  yaml << YAML::EndSeq;
+
+  std::string summary = (std::filesystem::path(output_dir_) / "mag_cal_summary.yaml").string();
+  std::ofstream fout(summary);
+  if (fout.is_open()) {
+    fout << yaml.c_str() << std::endl;
+  } else {
+    RCLCPP_ERROR(this->get_logger(), "Failed to write %s", summary.c_str());
+  }
+
+  RCLCPP_INFO(this->get_logger(), "Calibrated %zu of %zu captures, summary in %s", num_succeeded,
+              results.size(), summary.c_str());
+}
+
+bool CalibrateMag::calibrate_capture(const std::string & file, BatchResult & result)
+{
+  EigenSTL::vector_Vector3d meas;
+  if (!load_capture(file, meas)) {
+    RCLCPP_ERROR(this->get_logger(), "%s: failed to read capture", file.c_str());
+    return false;
+  }
+  result.num_measurements = meas.size();
+
+  Vector10d u;
+  if (online_fit_) {
+    Matrix10d DDt = Matrix10d::Zero();
+    for (const auto & item : meas) { addToScatter(item, DDt); }
+    u = ellipsoidLS(DDt);
+  } else {
+    u = ellipsoidRANSAC(meas, ransac_iters_, inlier_thresh_);
+  }
+
+  Ellipsoid ellipsoid;
+  if (!toEllipsoid(u, ellipsoid)) {
+    return false;
+  }
+  magCal(u, result.A, result.b);
+  if (!result.A.allFinite() || !result.b.allFinite()) {
+    return false;
+  }
+
+  // quality of the fit over the measurements RANSAC would keep
+  Matrix10d DDt = Matrix10d::Zero();
+  SphereCoverage coverage(2, 0);
+  result.num_inliers = 0;
+  for (const auto & item : meas) {
+    if (std::abs(surfaceDistance(item, ellipsoid)) <= inlier_thresh_) {
+      addToScatter(item, DDt);
+      coverage.add(result.A * (item - result.b));
+      result.num_inliers++;
+    }
+  }
+  if (result.num_inliers == 0) {
+    return false;
+  }
+  result.residual = fitResidual(u, ellipsoid, DDt, result.num_inliers);
+  result.coverage = coverage.coverage();
+  result.success = true;
+  return true;
+}
+
+bool CalibrateMag::load_capture(const std::string & file,
+                                EigenSTL::vector_Vector3d & measurements) const
+{
+  measurements.clear();
+  auto add_measurement = [&](double x, double y, double z) {
+    Eigen::Vector3d measurement(x, y, z);
+    if (measurements.empty() || measurement != measurements.back()) {
+      measurements.push_back(measurement);
+    }
+  };
+
+  std::filesystem::path path(file);
+  std::string extension = path.extension().string();
+  if (std::filesystem::is_directory(path) || extension == ".db3" || extension == ".mcap") {
+    try {
+      rosbag2_storage::StorageOptions storage_options;
+      storage_options.uri = file;
+      if (extension == ".db3") {
+        storage_options.storage_id = "sqlite3";
+      } else if (extension == ".mcap") {
+        storage_options.storage_id = "mcap";
+      }
+      rosbag2_cpp::ConverterOptions converter_options;
+      converter_options.input_serialization_format = "cdr";
+      converter_options.output_serialization_format = "cdr";
+
+      rosbag2_cpp::Reader reader;
+      reader.open(storage_options, converter_options);
+      rosbag2_storage::StorageFilter filter;
+      filter.topics.push_back(batch_topic_);
+      reader.set_filter(filter);
+
+      rclcpp::Serialization<sensor_msgs::msg::MagneticField> serialization;
+      while (reader.has_next()) {
+        auto bag_message = reader.read_next();
+        rclcpp::SerializedMessage serialized(*bag_message->serialized_data);
+        sensor_msgs::msg::MagneticField mag;
+        serialization.deserialize_message(&serialized, &mag);
+        add_measurement(mag.magnetic_field.x, mag.magnetic_field.y, mag.magnetic_field.z);
+      }
+    } catch (const std::exception & e) {
+      RCLCPP_ERROR(this->get_logger(), "%s: %s", file.c_str(), e.what());
+      return false;
+    }
+  } else {
+    std::ifstream fin(file, std::ios::binary);
+    if (!fin.is_open()) {
+      return false;
+    }
+
+    // frame with local parser state rather than a MAVLink channel, so logs can be read in parallel
+    mavlink_message_t rx_msg;
+    mavlink_status_t rx_status;
+    mavlink_message_t msg;
+    mavlink_status_t status;
+    memset(&rx_status, 0, sizeof(rx_status));
+    for (std::istreambuf_iterator<char> it(fin), end; it != end; ++it) {
+      if (mavlink_frame_char_buffer(&rx_msg, &rx_status, (uint8_t) *it, &msg, &status)
+            == MAVLINK_FRAMING_OK
+          && msg.msgid == MAVLINK_MSG_ID_SMALL_MAG) {
+        mavlink_small_mag_t mag;
+        mavlink_msg_small_mag_decode(&msg, &mag);
+        add_measurement(mag.xmag, mag.ymag, mag.zmag);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool CalibrateMag::writeParamFile(const BatchResult & result)
+{
+  std::vector<double> values = {result.A(0, 0), result.A(0, 1), result.A(0, 2), result.A(1, 0),
+                                result.A(1, 1), result.A(1, 2), result.A(2, 0), result.A(2, 1),
+                                result.A(2, 2), result.b(0),    result.b(1),    result.b(2)};
+
+  // same layout as the files written by the "param_save_to_file" service
+  YAML::Emitter yaml;
+  yaml << YAML::Comment("Magnetometer calibration of " + result.file);
+  yaml << YAML::Newline;
+  yaml << YAML::Comment("measurements: " + std::to_string(result.num_measurements)
+                        + ", inliers: " + std::to_string(result.num_inliers)
+                        + ", residual: " + std::to_string(result.residual)
+                        + ", coverage: " + std::to_string(result.coverage));
+  yaml << YAML::Newline;
+  yaml << YAML::BeginSeq;
+  for (size_t i = 0; i < CALIBRATION_PARAMS.size(); i++) {
+    yaml << YAML::Flow;
+    yaml << YAML::BeginMap;
+    yaml << YAML::Key << "name" << YAML::Value << CALIBRATION_PARAMS[i];
+    yaml << YAML::Key << "type" << YAML::Value << (int) MAV_PARAM_TYPE_REAL32;
+    yaml << YAML::Key << "value" << YAML::Value << values[i];
+    yaml << YAML::EndMap;
+  }
+  yaml << YAML::EndSeq;
+
+  std::ofstream fout(result.output);
+  if (!fout.is_open()) {
+    return false;
+  }
+  fout << yaml.c_str() << std::endl;
+  return true;
+}
+
+} // namespace rosflight_io
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file io_thread_pool.cpp
+ * \author agent <agent@local>
+ */
+
+#include <mutex>
+
+#include <rosflight_io/mavrosflight/io_thread_pool.hpp>
+
+namespace mavrosflight
+{
+IoThreadPool::IoThreadPool(size_t num_threads)
+    : io_service_()
+    , work_(new boost::asio::io_service::work(io_service_))
+{
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.create_thread(boost::bind(&boost::asio::io_service::run, &io_service_));
+  }
+}
+
+IoThreadPool::~IoThreadPool()
+{
+  work_.reset();
+  io_service_.stop();
+  threads_.join_all();
+}
+
+std::shared_ptr<IoThreadPool> IoThreadPool::get_shared(size_t num_threads)
+{
+  static std::mutex mutex;
+  static std::weak_ptr<IoThreadPool> shared_pool;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<IoThreadPool> pool = shared_pool.lock();
+  if (pool == nullptr) {
+    pool = std::make_shared<IoThreadPool>(num_threads);
+    shared_pool = pool;
+  }
+  return pool;
+}
+
+} // namespace mavrosflight
@@ -34,42 +34,85 @@
  * \author Daniel Koch <daniel.koch@byu.edu>
  */
 
+#include <cstring>
+
 #include <rosflight_io/mavrosflight/mavlink_comm.hpp>
+#include <rosflight_io/mavrosflight/serial_exception.hpp>
 
 namespace mavrosflight
 {
 using boost::asio::serial_port_base;
 
-MavlinkComm::MavlinkComm()
-    : io_service_()
+namespace
+{
+std::mutex channel_mutex;                           //!< mutex for the channel pool
+bool channel_in_use[MAVLINK_COMM_NUM_BUFFERS] = {}; //!< MAVLink parser channels claimed by links
+} // namespace
+
+MavlinkComm::MavlinkComm(std::shared_ptr<IoThreadPool> io_pool)
+    : io_pool_(io_pool)
+    , own_io_service_(io_pool ? nullptr : new boost::asio::io_service())
+    , io_service_(io_pool ? io_pool->io_service() : *own_io_service_)
+    , pending_operations_(0)
+    , channel_(-1)
     , read_buf_raw_()
     , msg_in_()
     , status_in_()
     , write_in_progress_(false)
 {}
 
-MavlinkComm::~MavlinkComm() = default;
+MavlinkComm::~MavlinkComm()
+{
+  if (channel_ >= 0) {
+    release_channel(channel_);
+  }
+}
 
 void MavlinkComm::open()
 {
   // open the port
   do_open();
 
+  // claim a parser channel, since the parser state for each channel is shared by the process
+  channel_ = acquire_channel();
+  if (channel_ < 0) {
+    do_close();
+    throw SerialException("No free MAVLink channels, too many links are open");
+  }
+  memset(mavlink_get_channel_status(channel_), 0, sizeof(mavlink_status_t));
+
   // start reading from the port
   async_read();
-  io_thread_ = boost::thread(boost::bind(&boost::asio::io_service::run, &this->io_service_));
+  if (own_io_service_) {
+    io_thread_ = boost::thread(boost::bind(&boost::asio::io_service::run, own_io_service_.get()));
+  }
 }
 
 void MavlinkComm::close()
 {
-  mutex_lock lock(mutex_);
+  {
+    mutex_lock lock(mutex_);
 
-  io_service_.stop();
-  do_close();
+    if (own_io_service_) {
+      own_io_service_->stop();
+    }
+    do_close();
+  }
 
   if (io_thread_.joinable()) {
     io_thread_.join();
   }
+
+  // handlers of cancelled operations still run on the shared pool, so wait for them to finish
+  if (io_pool_) {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_cv_.wait(lock, [this] { return pending_operations_ == 0; });
+  }
+
+  if (channel_ >= 0) {
+    release_channel(channel_);
+    channel_ = -1;
+  }
 }
 
 void MavlinkComm::register_mavlink_listener(MavlinkListenerInterface * const listener)
@@ -105,12 +148,91 @@ void MavlinkComm::unregister_mavlink_listener(MavlinkListenerInterface * const l
   }
 }
 
+void MavlinkComm::register_write_listener(MavlinkWriteListenerInterface * const listener)
+{
+  if (listener == nullptr) {
+    return;
+  }
+
+  mutex_lock lock(mutex_);
+  for (auto & item : write_listeners_) {
+    if (listener == item) {
+      return;
+    }
+  }
+  write_listeners_.push_back(listener);
+}
+
+void MavlinkComm::unregister_write_listener(MavlinkWriteListenerInterface * const listener)
+{
+  if (listener == nullptr) {
+    return;
+  }
+
+  mutex_lock lock(mutex_);
+  for (int i = 0; i < (int) write_listeners_.size(); i++) {
+    if (listener == write_listeners_[i]) {
+      write_listeners_.erase(write_listeners_.begin() + i);
+      i--;
+    }
+  }
+}
+
+void MavlinkComm::begin_operation()
+{
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  pending_operations_++;
+}
+
+void MavlinkComm::end_operation()
+{
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (--pending_operations_ == 0) {
+    pending_cv_.notify_all();
+  }
+}
+
+void MavlinkComm::handle_io_error(const boost::system::error_code & error)
+{
+  mutex_lock lock(mutex_);
+  if (!is_open()) {
+    return;
+  }
+
+  std::cerr << error.message() << std::endl;
+
+  // only stop and close here, since joining the io thread from within a handler would deadlock
+  if (own_io_service_) {
+    own_io_service_->stop();
+  }
+  do_close();
+}
+
+int MavlinkComm::acquire_channel()
+{
+  std::lock_guard<std::mutex> lock(channel_mutex);
+  for (int i = 0; i < MAVLINK_COMM_NUM_BUFFERS; i++) {
+    if (!channel_in_use[i]) {
+      channel_in_use[i] = true;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void MavlinkComm::release_channel(int channel)
+{
+  std::lock_guard<std::mutex> lock(channel_mutex);
+  channel_in_use[channel] = false;
+}
+
 void MavlinkComm::async_read()
 {
   if (!is_open()) {
     return;
   }
 
+  begin_operation();
   do_async_read(boost::asio::buffer(read_buf_raw_, MAVLINK_SERIAL_READ_BUF_SIZE),
                 boost::bind(&MavlinkComm::async_read_end, this, boost::asio::placeholders::error,
                             boost::asio::placeholders::bytes_transferred));
@@ -118,17 +240,19 @@ void MavlinkComm::async_read()
 
 void MavlinkComm::async_read_end(const boost::system::error_code & error, size_t bytes_transferred)
 {
+  OperationGuard guard(this);
+
   if (!is_open()) {
     return;
   }
 
   if (error) {
-    close();
+    handle_io_error(error);
     return;
   }
 
   for (int i = 0; i < (int) bytes_transferred; i++) {
-    if (mavlink_parse_char(MAVLINK_COMM_0, read_buf_raw_[i], &msg_in_, &status_in_)) {
+    if (mavlink_parse_char(channel_, read_buf_raw_[i], &msg_in_, &status_in_)) {
       for (auto & listener : listeners_) {
         listener->handle_mavlink_message(msg_in_);
       }
@@ -143,6 +267,8 @@ void MavlinkComm::send_message(const mavlink_message_t & msg)
   auto * buffer = new WriteBuffer();
   buffer->len = mavlink_msg_to_send_buffer(buffer->data, &msg);
   assert(buffer->len <= MAVLINK_MAX_PACKET_LEN); //! \todo Do something less catastrophic here
+  buffer->msgid = msg.msgid;
+  buffer->enqueue_time = std::chrono::steady_clock::now();
 
   {
     mutex_lock lock(mutex_);
@@ -159,12 +285,14 @@ void MavlinkComm::async_write(bool check_write_state)
   }
 
   mutex_lock lock(mutex_);
-  if (write_queue_.empty()) {
+  if (write_queue_.empty() || !is_open()) {
+    write_in_progress_ = false;
     return;
   }
 
   write_in_progress_ = true;
   WriteBuffer * buffer = write_queue_.front();
+  begin_operation();
   do_async_write(boost::asio::buffer(buffer->dpos(), buffer->nbytes()),
                  boost::bind(&MavlinkComm::async_write_end, this, boost::asio::placeholders::error,
                              boost::asio::placeholders::bytes_transferred));
@@ -173,9 +301,10 @@ void MavlinkComm::async_write(bool check_write_state)
 void MavlinkComm::async_write_end(const boost::system::error_code & error,
                                   std::size_t bytes_transferred)
 {
+  OperationGuard guard(this);
+
   if (error) {
-    std::cerr << error.message() << std::endl;
-    close();
+    handle_io_error(error);
     return;
   }
 
@@ -188,6 +317,12 @@ void MavlinkComm::async_write_end(const boost::system::error_code & error,
   WriteBuffer * buffer = write_queue_.front();
   buffer->pos += bytes_transferred;
   if (buffer->nbytes() == 0) {
+    if (!write_listeners_.empty()) {
+      auto write_time = std::chrono::steady_clock::now();
+      for (auto & listener : write_listeners_) {
+        listener->on_message_written(buffer->msgid, buffer->enqueue_time, write_time);
+      }
+    }
     write_queue_.pop_front();
     delete buffer;
   }
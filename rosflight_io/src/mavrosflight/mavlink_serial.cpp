@@ -41,8 +41,9 @@ namespace mavrosflight
 {
 using boost::asio::serial_port_base;
 
-MavlinkSerial::MavlinkSerial(std::string port, int baud_rate)
-    : MavlinkComm()
+MavlinkSerial::MavlinkSerial(std::string port, int baud_rate,
+                             std::shared_ptr<IoThreadPool> io_pool)
+    : MavlinkComm(std::move(io_pool))
     , serial_port_(io_service_)
     , port_(std::move(port))
     , baud_rate_(baud_rate)
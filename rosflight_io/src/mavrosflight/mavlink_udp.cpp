@@ -44,8 +44,8 @@ namespace mavrosflight
 using boost::asio::serial_port_base;
 
 MavlinkUDP::MavlinkUDP(std::string bind_host, uint16_t bind_port, std::string remote_host,
-                       uint16_t remote_port)
-    : MavlinkComm()
+                       uint16_t remote_port, std::shared_ptr<IoThreadPool> io_pool)
+    : MavlinkComm(std::move(io_pool))
     , bind_host_(std::move(bind_host))
     , bind_port_(bind_port)
     , remote_host_(std::move(remote_host))
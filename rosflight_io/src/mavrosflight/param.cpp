@@ -74,19 +74,24 @@ MAV_PARAM_TYPE Param::getType() const { return type_; }
 
 double Param::getValue() const { return value_; }
 
-void Param::requestSet(double value, mavlink_message_t * msg)
+bool Param::requestSet(double value, mavlink_message_t * msg)
 {
-  if (value != value_) {
-    new_value_ = getCastValue(value);
-    expected_raw_value_ = getRawValue(new_value_);
+  if (!differsFrom(value) && !set_in_progress_) {
+    return false;
+  }
 
-    mavlink_msg_param_set_pack(1, 50, msg, 1, MAV_COMP_ID_ALL, name_.c_str(), expected_raw_value_,
-                               type_);
+  new_value_ = getCastValue(value);
+  expected_raw_value_ = getRawValue(new_value_);
 
-    set_in_progress_ = true;
-  }
+  mavlink_msg_param_set_pack(1, 50, msg, 1, MAV_COMP_ID_ALL, name_.c_str(), expected_raw_value_,
+                             type_);
+
+  set_in_progress_ = true;
+  return true;
 }
 
+bool Param::differsFrom(double value) const { return getCastValue(value) != value_; }
+
 bool Param::handleUpdate(const mavlink_param_value_t & msg)
 {
   if (msg.param_index != index_) {
@@ -109,6 +114,8 @@ bool Param::handleUpdate(const mavlink_param_value_t & msg)
   return false;
 }
 
+bool Param::isSetInProgress() const { return set_in_progress_; }
+
 void Param::init(std::string name, int index, MAV_PARAM_TYPE type, float raw_value)
 {
   name_ = std::move(name);
@@ -153,9 +160,9 @@ void Param::setFromRawValue(float raw_value)
   }
 }
 
-float Param::getRawValue() { return getRawValue(value_); }
+float Param::getRawValue() const { return getRawValue(value_); }
 
-float Param::getRawValue(double value)
+float Param::getRawValue(double value) const
 {
   float raw_value = 0.0f;
 
@@ -194,7 +201,7 @@ float Param::getRawValue(double value)
   return raw_value;
 }
 
-double Param::getCastValue(double value)
+double Param::getCastValue(double value) const
 {
   double cast_value = 0.0f;
 
@@ -34,6 +34,12 @@
  * \author Daniel Koch <daniel.koch@byu.edu>
  */
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 
@@ -42,16 +48,46 @@
 
 namespace mavrosflight
 {
+namespace
+{
+/**
+ * \brief Replace characters that don't belong in a file name
+ */
+std::string sanitize_file_name(const std::string & name)
+{
+  std::string result;
+  for (char c : name) {
+    result += (std::isalnum((unsigned char) c) || c == '.' || c == '-' || c == '_') ? c : '_';
+  }
+  size_t start = result.find_first_not_of('_');
+  return start == std::string::npos ? "" : result.substr(start);
+}
+} // namespace
+
 ParamManager::ParamManager(MavlinkComm * const comm, rclcpp::Node * const node)
     : node_(node)
     , comm_(comm)
+    , latest_change_(0)
     , unsaved_changes_(false)
     , write_request_in_progress_(false)
     , first_param_received_(false)
     , num_params_(0)
     , received_count_(0)
-    , received_(nullptr)
     , got_all_params_(false)
+    , list_streaming_(false)
+    , list_retries_(0)
+    , highest_index_(-1)
+    , have_rtt_(false)
+    , srtt_ms_(0.0)
+    , rttvar_ms_(0.0)
+    , rto_ms_(INITIAL_RTO.count())
+    , num_requests_(0)
+    , num_retransmissions_(0)
+    , cache_state_(CacheState::UNUSED)
+    , cache_stale_(false)
+    , sets_in_flight_(0)
+    , num_sets_(0)
+    , num_set_retransmissions_(0)
     , param_set_in_progress_(false)
 {
   comm_->register_mavlink_listener(this);
@@ -59,15 +95,14 @@ ParamManager::ParamManager(MavlinkComm * const comm, rclcpp::Node * const node)
   param_set_timer_ =
     node_->create_wall_timer(std::chrono::milliseconds(10),
                              std::bind(&ParamManager::param_set_timer_callback, this), nullptr);
-}
 
-ParamManager::~ParamManager()
-{
-  if (first_param_received_) {
-    delete[] received_;
-  }
+  download_timer_ = node_->create_wall_timer(
+    DOWNLOAD_PERIOD, std::bind(&ParamManager::download_timer_callback, this), nullptr);
+  download_timer_->cancel();
 }
 
+ParamManager::~ParamManager() = default;
+
 void ParamManager::handle_mavlink_message(const mavlink_message_t & msg)
 {
   switch (msg.msgid) {
@@ -84,8 +119,10 @@ bool ParamManager::unsaved_changes() const { return unsaved_changes_; }
 
 bool ParamManager::get_param_value(const std::string & name, double * value)
 {
-  if (is_param_id(name)) {
-    *value = params_[name].getValue();
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+  int index = find_param(name);
+  if (index >= 0) {
+    *value = params_[index].getValue();
     return true;
   } else {
     *value = 0.0;
@@ -95,20 +132,59 @@ bool ParamManager::get_param_value(const std::string & name, double * value)
 
 bool ParamManager::set_param_value(const std::string & name, double value)
 {
-  if (is_param_id(name)) {
-    mavlink_message_t msg;
-    params_[name].requestSet(value, &msg);
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+  int index = find_param(name);
+  if (index < 0) {
+    return false;
+  }
 
-    param_set_queue_.push_back(msg);
-    if (!param_set_in_progress_) {
-      param_set_timer_->reset();
-      param_set_in_progress_ = true;
-    }
+  for (auto & listener : listeners_) {
+    listener->on_param_set_requested(name, params_[index].getCastValue(value));
+  }
 
+  mavlink_message_t msg;
+  if (!params_[index].requestSet(value, &msg)) {
+    // already set to this value
+    for (auto & listener : listeners_) {
+      listener->on_param_set_result(name, true, params_[index].getValue());
+    }
     return true;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (pending_sets_.empty()) {
+    // start of a new upload
+    failed_sets_.clear();
+    num_sets_ = 0;
+    num_set_retransmissions_ = 0;
+    upload_start_ = now;
+  }
+
+  auto set = pending_sets_.find(index);
+  if (set == pending_sets_.end()) {
+    pending_sets_[index] = ParamSet{value, msg, false, now, 0, 0};
+    param_set_queue_.push_back(index);
+    num_sets_++;
   } else {
-    return false;
+    // the new value replaces the one that was requested before. This is a new set rather than a
+    // retransmission, so it gets the full number of retries.
+    set->second.value = value;
+    set->second.msg = msg;
+    set->second.retries = 0;
+    if (set->second.in_flight) {
+      set->second.send_time = now;
+      set->second.superseded++;
+      comm_->send_message(msg);
+    }
+  }
+  fill_upload_window(now);
+
+  if (!param_set_in_progress_) {
+    param_set_timer_->reset();
+    param_set_in_progress_ = true;
   }
+
+  return true;
 }
 
 bool ParamManager::write_params()
@@ -162,16 +238,18 @@ void ParamManager::unregister_param_listener(ParamListenerInterface * listener)
 
 bool ParamManager::save_to_file(const std::string & filename)
 {
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+
   // build YAML document
   YAML::Emitter yaml;
   yaml << YAML::BeginSeq;
-  std::map<std::string, Param>::iterator it;
-  for (it = params_.begin(); it != params_.end(); it++) {
+  for (const auto & entry : param_names_) {
+    const Param & param = params_[entry.second];
     yaml << YAML::Flow;
     yaml << YAML::BeginMap;
-    yaml << YAML::Key << "name" << YAML::Value << it->second.getName();
-    yaml << YAML::Key << "type" << YAML::Value << (int) it->second.getType();
-    yaml << YAML::Key << "value" << YAML::Value << it->second.getValue();
+    yaml << YAML::Key << "name" << YAML::Value << param.getName();
+    yaml << YAML::Key << "type" << YAML::Value << (int) param.getType();
+    yaml << YAML::Key << "value" << YAML::Value << param.getValue();
     yaml << YAML::EndMap;
   }
   yaml << YAML::EndSeq;
@@ -191,17 +269,52 @@ bool ParamManager::save_to_file(const std::string & filename)
 
 bool ParamManager::load_from_file(const std::string & filename)
 {
+  ParamFileDiff diff;
+  if (!diff_file(filename, true, &diff)) {
+    return false;
+  }
+
+  RCLCPP_INFO(node_->get_logger(), "Loaded %s: %zu of %zu parameters differ, sent %zu",
+              filename.c_str(), diff.changed.size(), diff.num_entries, diff.num_sent);
+  if (!diff.type_mismatches.empty() || !diff.missing.empty()) {
+    RCLCPP_WARN(node_->get_logger(),
+                "Skipped %zu parameters with a different type and %zu that are not onboard",
+                diff.type_mismatches.size(), diff.missing.size());
+  }
+  return true;
+}
+
+bool ParamManager::diff_file(const std::string & filename, bool upload, ParamFileDiff * diff)
+{
+  *diff = ParamFileDiff();
+
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
   try {
     YAML::Node root = YAML::LoadFile(filename);
-    assert(root.IsSequence());
+    if (!root.IsSequence()) {
+      return false;
+    }
 
     for (auto && item : root) {
-      if (item.IsMap() && item["name"] && item["type"] && item["value"]) {
-        if (is_param_id(item["name"].as<std::string>())) {
-          Param param = params_.find(item["name"].as<std::string>())->second;
-          if ((MAV_PARAM_TYPE) item["type"].as<int>() == param.getType()) {
-            set_param_value(item["name"].as<std::string>(), item["value"].as<double>());
-          }
+      if (!(item.IsMap() && item["name"] && item["type"] && item["value"])) {
+        continue;
+      }
+      diff->num_entries++;
+
+      std::string name = item["name"].as<std::string>();
+      double value = item["value"].as<double>();
+      int index = find_param(name);
+      if (index < 0) {
+        diff->missing.push_back(name);
+      } else if ((MAV_PARAM_TYPE) item["type"].as<int>() != params_[index].getType()) {
+        diff->type_mismatches.push_back(name);
+      } else if (params_[index].differsFrom(value)) {
+        diff->changed.push_back(name);
+        diff->onboard_values.push_back(params_[index].getValue());
+        diff->file_values.push_back(value);
+
+        if (upload && set_param_value(name, value)) {
+          diff->num_sent++;
         }
       }
     }
@@ -214,14 +327,51 @@ bool ParamManager::load_from_file(const std::string & filename)
 
 void ParamManager::request_params()
 {
+  std::lock_guard<std::mutex> lock(download_mutex_);
+  if (got_all_params_) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
   if (!first_param_received_) {
-    request_param_list();
-  } else {
-    for (int i = 0; i < num_params_; i++) {
-      if (!received_[i]) {
-        request_param(i);
+    if (cache_state_ == CacheState::UNUSED && !list_streaming_) {
+      download_start_ = now;
+      if (cache_dir_.empty()) {
+        start_list_download(now);
+      } else if (firmware_version_.empty()) {
+        cache_state_ = CacheState::WAITING_FOR_VERSION;
+      } else {
+        start_cache_check(now);
       }
     }
+  } else {
+    queue_missing_params();
+    fill_download_window(now);
+  }
+
+  download_timer_->reset();
+}
+
+void ParamManager::enable_cache(const std::string & directory, const std::string & name)
+{
+  std::lock_guard<std::mutex> lock(download_mutex_);
+  cache_dir_ = directory;
+  cache_name_ = sanitize_file_name(name);
+}
+
+void ParamManager::set_firmware_version(const std::string & version, uint8_t sysid,
+                                        uint8_t compid)
+{
+  std::lock_guard<std::mutex> lock(download_mutex_);
+  std::string vehicle_id = "sys" + std::to_string(sysid) + "_comp" + std::to_string(compid);
+  if (version == firmware_version_ && vehicle_id == vehicle_id_) {
+    return;
+  }
+
+  firmware_version_ = version;
+  vehicle_id_ = vehicle_id;
+  if (cache_state_ == CacheState::WAITING_FOR_VERSION) {
+    start_cache_check(std::chrono::steady_clock::now());
   }
 }
 
@@ -232,6 +382,170 @@ void ParamManager::request_param_list()
   comm_->send_message(param_list_msg);
 }
 
+void ParamManager::start_list_download(std::chrono::steady_clock::time_point now)
+{
+  // the firmware streams the whole list in response
+  list_request_time_ = now;
+  list_retries_ = 0;
+  list_streaming_ = true;
+  request_param_list();
+}
+
+void ParamManager::start_cache_check(std::chrono::steady_clock::time_point now)
+{
+  std::string filename = cache_file();
+  if (!load_cache(filename)) {
+    RCLCPP_INFO(node_->get_logger(), "No usable parameter cache at %s, downloading parameters",
+                filename.c_str());
+    cache_state_ = CacheState::UNUSED;
+    start_list_download(now);
+    return;
+  }
+
+  // spot check parameters spread over the whole list, including the last one, which also checks
+  // that the firmware has the same number of parameters
+  cache_state_ = CacheState::SPOT_CHECK;
+  spot_check_.clear();
+  for (size_t i = 0; i < SPOT_CHECK_COUNT; i++) {
+    spot_check_.insert((int) (i * (cache_.size() - 1) / (SPOT_CHECK_COUNT - 1)));
+  }
+  for (int index : spot_check_) { send_param_request(index, now); }
+}
+
+std::string ParamManager::cache_file() const
+{
+  if (cache_dir_.empty() || firmware_version_.empty()) {
+    return "";
+  }
+  return cache_dir_ + "/" + cache_name_ + "__" + vehicle_id_ + "__"
+    + sanitize_file_name(firmware_version_) + ".yaml";
+}
+
+bool ParamManager::load_cache(const std::string & filename)
+{
+  cache_.clear();
+  try {
+    YAML::Node root = YAML::LoadFile(filename);
+    if (root["version"].as<std::string>() != firmware_version_ || !root["params"].IsSequence()) {
+      return false;
+    }
+
+    std::vector<Param> params(root["params"].size());
+    for (auto && item : root["params"]) {
+      int index = item["index"].as<int>();
+      if (index < 0 || index >= (int) params.size() || params[index].getIndex() >= 0) {
+        return false;
+      }
+
+      uint32_t raw_bits = item["raw"].as<uint32_t>();
+      float raw_value;
+      memcpy(&raw_value, &raw_bits, sizeof(raw_value));
+      params[index] = Param(item["name"].as<std::string>(), index,
+                            (MAV_PARAM_TYPE) item["type"].as<int>(), raw_value);
+    }
+
+    if (params.empty() || std::stoull(root["hash"].as<std::string>(), nullptr, 16)
+                            != hash_params(params)) {
+      return false;
+    }
+    cache_ = std::move(params);
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+void ParamManager::save_cache(const std::string & filename, const std::string & version)
+{
+  if (filename.empty()) {
+    return;
+  }
+
+  std::vector<Param> params;
+  {
+    std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+    if (param_names_.size() != params_.size()) {
+      return; // not a complete set of parameters
+    }
+    params = params_;
+  }
+
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) hash_params(params));
+
+  YAML::Emitter yaml;
+  yaml << YAML::BeginMap;
+  yaml << YAML::Key << "version" << YAML::Value << version;
+  yaml << YAML::Key << "hash" << YAML::Value << hash;
+  yaml << YAML::Key << "params" << YAML::Value << YAML::BeginSeq;
+  for (const Param & param : params) {
+    float raw_value = param.getRawValue();
+    uint32_t raw_bits;
+    memcpy(&raw_bits, &raw_value, sizeof(raw_bits));
+
+    yaml << YAML::Flow;
+    yaml << YAML::BeginMap;
+    yaml << YAML::Key << "name" << YAML::Value << param.getName();
+    yaml << YAML::Key << "index" << YAML::Value << param.getIndex();
+    yaml << YAML::Key << "type" << YAML::Value << (int) param.getType();
+    yaml << YAML::Key << "raw" << YAML::Value << raw_bits;
+    yaml << YAML::EndMap;
+  }
+  yaml << YAML::EndSeq;
+  yaml << YAML::EndMap;
+
+  // write to a temporary file first, so an interrupted write never leaves a corrupt cache
+  try {
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path());
+    std::string tmp_filename = filename + ".tmp";
+    std::ofstream fout(tmp_filename);
+    fout << yaml.c_str();
+    fout.close();
+    std::filesystem::rename(tmp_filename, filename);
+    RCLCPP_DEBUG(node_->get_logger(), "Saved parameter cache to %s", filename.c_str());
+  } catch (const std::exception & e) {
+    RCLCPP_WARN(node_->get_logger(), "Failed to save parameter cache to %s: %s",
+                filename.c_str(), e.what());
+  }
+}
+
+bool ParamManager::matches_cache(const mavlink_param_value_t & param) const
+{
+  if ((size_t) param.param_count != cache_.size() || (size_t) param.param_index >= cache_.size()) {
+    return false;
+  }
+
+  const Param & cached = cache_[param.param_index];
+  float cached_raw_value = cached.getRawValue();
+  bool same_name = strncmp(cached.getName().c_str(), param.param_id,
+                           MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN)
+    == 0;
+  return same_name && cached.getType() == param.param_type
+    && memcmp(&cached_raw_value, &param.param_value, sizeof(float)) == 0;
+}
+
+uint64_t ParamManager::hash_params(const std::vector<Param> & params)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  auto add = [&hash](const void * data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      hash ^= static_cast<const uint8_t *>(data)[i];
+      hash *= 1099511628211ULL;
+    }
+  };
+
+  for (const Param & param : params) {
+    int32_t index = param.getIndex();
+    uint8_t type = param.getType();
+    float raw_value = param.getRawValue();
+    add(&index, sizeof(index));
+    add(param.getName().c_str(), param.getName().size() + 1);
+    add(&type, sizeof(type));
+    add(&raw_value, sizeof(raw_value));
+  }
+  return hash;
+}
+
 void ParamManager::request_param(int index)
 {
   mavlink_message_t param_request_msg;
@@ -246,46 +560,193 @@ void ParamManager::handle_param_value_msg(const mavlink_message_t & msg)
   mavlink_param_value_t param;
   mavlink_msg_param_value_decode(&msg, &param);
 
-  if (!first_param_received_) {
-    first_param_received_ = true;
-    num_params_ = param.param_count;
-    received_ = new bool[num_params_];
-    for (int i = 0; i < num_params_; i++) {
-      received_[i] = false;
+  bool verifying = false;        // reply to a background verification of the cache
+  bool spot_check_reply = false; // reply to a spot check request, not part of the streamed list
+  std::vector<Param> cached;     // cached params to add, once the spot check passed
+  std::string save_filename;     // cache file to write, once the download is complete
+  std::string save_version;
+  {
+    std::lock_guard<std::mutex> lock(download_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    int index = param.param_index;
+
+    if (!first_param_received_) {
+      first_param_received_ = true;
+      num_params_ = param.param_count;
+      received_.assign(num_params_, false);
+
+      // the first reply to the list request is the first round trip time measurement
+      if (list_retries_ == 0 && list_streaming_) {
+        update_rtt(now - list_request_time_);
+      }
+    }
+    last_param_time_ = now;
+
+    if (index >= 0 && index < num_params_) {
+      auto request = in_flight_.find(index);
+      if (request != in_flight_.end()) {
+        // Karn's algorithm: only time replies that can't be to a retransmission
+        if (request->second.retries == 0) {
+          update_rtt(now - request->second.send_time);
+        }
+
+        // requests sent before this one are likely lost if enough later ones got answered
+        for (auto & other : in_flight_) {
+          if (other.first != index && other.second.send_time < request->second.send_time
+              && ++other.second.later_replies >= FAST_RETRANSMIT_THRESHOLD) {
+            send_param_request(other.first, now);
+          }
+        }
+        in_flight_.erase(request);
+      }
+
+      if (cache_state_ == CacheState::SPOT_CHECK) {
+        spot_check_reply = true;
+        if (!matches_cache(param)) {
+          // the remaining spot checks stay listed, so their late replies are recognized
+          RCLCPP_INFO(node_->get_logger(),
+                      "Parameter cache is out of date, downloading all parameters");
+          cache_state_ = CacheState::UNUSED;
+          cache_.clear();
+          in_flight_.clear();
+          spot_check_.erase(index);
+          start_list_download(now);
+        } else if (spot_check_.erase(index) > 0 && spot_check_.empty()) {
+          cached = cache_;
+        }
+      } else if (cache_state_ == CacheState::UNUSED && spot_check_.count(index) > 0) {
+        spot_check_reply = true;
+      } else if (cache_state_ == CacheState::VERIFYING) {
+        verifying = true;
+        if (!matches_cache(param)) {
+          cache_stale_ = true;
+        }
+      }
+
+      if (!cached.empty()) {
+        // spot check passed, use the cache and verify the rest in the background
+        received_.assign(num_params_, true);
+        received_count_ = num_params_;
+        got_all_params_ = true;
+        cache_state_ = CacheState::VERIFYING;
+        cache_stale_ = false;
+        verify_queue_.clear();
+        for (int i = 0; i < num_params_; i++) { verify_queue_.push_back(i); }
+        last_verify_time_ = now;
+        RCLCPP_INFO(node_->get_logger(), "Loaded %d parameters from cache in %0.2f s",
+                    num_params_, std::chrono::duration<double>(now - download_start_).count());
+      } else if (!got_all_params_) {
+        // the list is streamed in order, so skipped indices were lost. Spot check replies are
+        // answers to individual requests and don't say anything about the stream.
+        if (list_streaming_ && !spot_check_reply && index > highest_index_) {
+          for (int i = highest_index_ + 1; i < index; i++) {
+            if (!received_[i]) {
+              pending_.push_back(i);
+            }
+          }
+          highest_index_ = index;
+        }
+
+        if (!received_[index]) {
+          received_[index] = true;
+          received_count_++;
+        }
+
+        if (received_count_ == num_params_) {
+          got_all_params_ = true;
+          in_flight_.clear();
+          pending_.clear();
+          spot_check_.clear();
+          save_filename = cache_file();
+          save_version = firmware_version_;
+          RCLCPP_INFO(node_->get_logger(),
+                      "Received all %d parameters in %0.2f s (%zu requests, %zu retransmitted, "
+                      "RTO %0.0f ms)",
+                      num_params_,
+                      std::chrono::duration<double>(now - download_start_).count(),
+                      num_requests_, num_retransmissions_, rto_ms_);
+        } else {
+          fill_download_window(now);
+        }
+      }
     }
   }
 
-  // ensure null termination of name
-  char c_name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN + 1];
-  memcpy(c_name, param.param_id, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
-  c_name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN] = '\0';
+  std::unique_lock<std::recursive_mutex> lock(params_mutex_);
+  for (const Param & cached_param : cached) {
+    if (!has_param(cached_param.getIndex())) {
+      add_param(cached_param);
+      for (auto & listener : listeners_) {
+        listener->on_new_param_received(cached_param.getName(), cached_param.getValue());
+      }
+    }
+  }
 
-  std::string name(c_name);
+  // look the param up by index, only falling back to the name if the index is unusable
+  int index = param.param_index;
+  if (index >= param.param_count) {
+    index = find_param(param_name(param));
+    if (index < 0) {
+      return;
+    }
+  }
 
-  if (!is_param_id(name)) // if we haven't received this param before, add it
+  if (!has_param(index)) // if we haven't received this param before, add it
   {
-    params_[name] = Param(param);
-    received_[param.param_index] = true;
-
-    // increase the param count
-    received_count_++;
-    if (received_count_ == num_params_) {
-      got_all_params_ = true;
+    if ((size_t) param.param_count > params_.size()) {
+      params_.resize(param.param_count);
     }
+    add_param(Param(param));
 
     for (auto & listener : listeners_) {
-      listener->on_new_param_received(name, params_[name].getValue());
+      listener->on_new_param_received(params_[index].getName(), params_[index].getValue());
+    }
+  } else if (verifying && pending_sets_.find(index) == pending_sets_.end()) {
+    // background verification found a cached value that is out of date
+    double old_value = params_[index].getValue();
+    if (params_[index].handleUpdate(param)) {
+      record_change(index, old_value);
+      RCLCPP_WARN(node_->get_logger(), "Cached value of parameter %s was out of date, now %g",
+                  params_[index].getName().c_str(), params_[index].getValue());
+      for (auto & listener : listeners_) {
+        listener->on_param_value_updated(params_[index].getName(), params_[index].getValue());
+      }
     }
   } else // otherwise check if we have new unsaved changes as a result of a param set request
   {
-    if (params_[name].handleUpdate(param)) {
+    double old_value = params_[index].getValue();
+    if (params_[index].handleUpdate(param)) {
+      record_change(index, old_value);
       unsaved_changes_ = true;
       for (auto & listener : listeners_) {
-        listener->on_param_value_updated(name, params_[name].getValue());
+        listener->on_param_value_updated(params_[index].getName(), params_[index].getValue());
         listener->on_params_saved_change(unsaved_changes_);
       }
     }
+
+    // match the echo to an outstanding set
+    auto set = pending_sets_.find(index);
+    if (set != pending_sets_.end() && set->second.in_flight) {
+      auto now = std::chrono::steady_clock::now();
+      if (!params_[index].isSetInProgress()) {
+        if (set->second.retries == 0) {
+          std::lock_guard<std::mutex> download_lock(download_mutex_);
+          update_rtt(now - set->second.send_time);
+        }
+        finish_set(set, true);
+        fill_upload_window(now);
+      } else if (set->second.superseded > 0) {
+        // echo of a value this set replaced, the timer retries if the new value's echo is lost
+        set->second.superseded--;
+      } else {
+        // the firmware reports a different value, so the set was lost or overwritten
+        retry_set(set, now);
+      }
+    }
   }
+
+  lock.unlock();
+  save_cache(save_filename, save_version);
 }
 
 void ParamManager::handle_command_ack_msg(const mavlink_message_t & msg)
@@ -300,6 +761,18 @@ void ParamManager::handle_command_ack_msg(const mavlink_message_t & msg)
         RCLCPP_INFO(node_->get_logger(), "Param write succeeded");
         unsaved_changes_ = false;
 
+        // the saved values are what the firmware will have after a reboot
+        std::string filename;
+        std::string version;
+        {
+          std::lock_guard<std::mutex> lock(download_mutex_);
+          if (got_all_params_) {
+            filename = cache_file();
+            version = firmware_version_;
+          }
+        }
+        save_cache(filename, version);
+
         for (auto & listener : listeners_) {
           listener->on_params_saved_change(unsaved_changes_);
         }
@@ -313,13 +786,91 @@ void ParamManager::handle_command_ack_msg(const mavlink_message_t & msg)
   }
 }
 
-bool ParamManager::is_param_id(const std::string & name)
+int ParamManager::find_param(const std::string & name) const
+{
+  auto entry = std::lower_bound(
+    param_names_.begin(), param_names_.end(), name,
+    [](const std::pair<std::string, int> & entry, const std::string & name) {
+      return entry.first < name;
+    });
+  if (entry == param_names_.end() || entry->first != name) {
+    return -1;
+  }
+  return entry->second;
+}
+
+bool ParamManager::has_param(int index) const
+{
+  return index >= 0 && index < (int) params_.size() && params_[index].getIndex() == index;
+}
+
+void ParamManager::add_param(const Param & param)
+{
+  int index = param.getIndex();
+  if (index >= (int) params_.size()) {
+    params_.resize(index + 1);
+  }
+  params_[index] = param;
+
+  auto entry = std::lower_bound(
+    param_names_.begin(), param_names_.end(), param.getName(),
+    [](const std::pair<std::string, int> & entry, const std::string & name) {
+      return entry.first < name;
+    });
+  if (entry != param_names_.end() && entry->first == param.getName()) {
+    entry->second = index;
+  } else {
+    param_names_.insert(entry, std::make_pair(param.getName(), index));
+  }
+}
+
+std::string ParamManager::param_name(const mavlink_param_value_t & param)
+{
+  // ensure null termination of name
+  char c_name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN + 1];
+  memcpy(c_name, param.param_id, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
+  c_name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN] = '\0';
+  return std::string(c_name);
+}
+
+void ParamManager::record_change(int index, double old_value)
+{
+  ParamChange change;
+  change.sequence = ++latest_change_;
+  change.index = index;
+  change.old_value = old_value;
+  change.new_value = params_[index].getValue();
+  change.time = node_->get_clock()->now();
+
+  change_journal_.push_back(change);
+  if (change_journal_.size() > CHANGE_JOURNAL_SIZE) {
+    change_journal_.pop_front();
+  }
+}
+
+bool ParamManager::get_changes_since(uint64_t sequence, std::vector<ParamChange> * changes,
+                                     uint64_t * latest)
 {
-  return (params_.find(name) != params_.end());
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+  changes->clear();
+  *latest = latest_change_;
+
+  // the journal is ordered by sequence number, so skip straight to the first newer change
+  auto first = std::upper_bound(change_journal_.begin(), change_journal_.end(), sequence,
+                                [](uint64_t sequence, const ParamChange & change) {
+                                  return sequence < change.sequence;
+                                });
+  for (auto change = first; change != change_journal_.end(); change++) {
+    changes->push_back(*change);
+    changes->back().name = params_[change->index].getName();
+  }
+
+  return change_journal_.empty() || change_journal_.front().sequence <= sequence + 1;
 }
 
 int ParamManager::get_num_params() const
 {
+  std::lock_guard<std::mutex> lock(download_mutex_);
   if (first_param_received_) {
     return num_params_;
   } else {
@@ -327,18 +878,238 @@ int ParamManager::get_num_params() const
   }
 }
 
-int ParamManager::get_params_received() const { return received_count_; }
+int ParamManager::get_params_received() const
+{
+  std::lock_guard<std::mutex> lock(download_mutex_);
+  return received_count_;
+}
+
+bool ParamManager::got_all_params() const
+{
+  std::lock_guard<std::mutex> lock(download_mutex_);
+  return got_all_params_;
+}
+
+void ParamManager::download_timer_callback()
+{
+  std::unique_lock<std::mutex> lock(download_mutex_);
+  if (got_all_params_ && cache_state_ != CacheState::VERIFYING) {
+    download_timer_->cancel();
+    return;
+  }
 
-bool ParamManager::got_all_params() const { return got_all_params_; }
+  auto now = std::chrono::steady_clock::now();
+  if (cache_state_ == CacheState::WAITING_FOR_VERSION) {
+    if (now - download_start_ > CACHE_VERSION_TIMEOUT) {
+      RCLCPP_INFO(node_->get_logger(), "No firmware version received, not using parameter cache");
+      cache_state_ = CacheState::UNUSED;
+      start_list_download(now);
+    }
+    return;
+  }
+
+  if (!first_param_received_ && list_streaming_) {
+    // nothing heard yet, keep asking for the list with exponential backoff
+    if (now - list_request_time_ > retransmit_timeout(list_retries_)) {
+      list_request_time_ = now;
+      list_retries_++;
+      request_param_list();
+    }
+    return;
+  }
+
+  // once the stream stalls, request everything that is still missing
+  if (list_streaming_
+      && now - last_param_time_ > std::max<std::chrono::steady_clock::duration>(
+           retransmit_timeout(0), MIN_STREAM_STALL)) {
+    list_streaming_ = false;
+    queue_missing_params();
+  }
+
+  for (auto & request : in_flight_) {
+    if (now - request.second.send_time > retransmit_timeout(request.second.retries)) {
+      send_param_request(request.first, now);
+    }
+  }
+
+  if (cache_state_ == CacheState::VERIFYING) {
+    // verify one parameter at a time, so the background check doesn't crowd out other traffic
+    if (in_flight_.empty() && verify_queue_.empty()) {
+      cache_state_ = CacheState::UNUSED;
+      std::string filename = cache_stale_ ? cache_file() : "";
+      std::string version = firmware_version_;
+      RCLCPP_INFO(node_->get_logger(), "Verified cached parameters%s",
+                  cache_stale_ ? ", updating out of date cache" : "");
+      lock.unlock();
+      save_cache(filename, version);
+    } else if (in_flight_.empty() && now - last_verify_time_ >= VERIFY_PERIOD) {
+      send_param_request(verify_queue_.front(), now);
+      verify_queue_.pop_front();
+      last_verify_time_ = now;
+    }
+    return;
+  }
+
+  fill_download_window(now);
+
+  RCLCPP_INFO_THROTTLE(node_->get_logger(), *node_->get_clock(), 1000,
+                       "Received %d of %d parameters", received_count_, num_params_);
+}
+
+void ParamManager::fill_download_window(std::chrono::steady_clock::time_point now)
+{
+  while (in_flight_.size() < DOWNLOAD_WINDOW && !pending_.empty()) {
+    int index = pending_.front();
+    pending_.pop_front();
+    if (!received_[index] && in_flight_.find(index) == in_flight_.end()) {
+      send_param_request(index, now);
+    }
+  }
+}
+
+void ParamManager::send_param_request(int index, std::chrono::steady_clock::time_point now)
+{
+  auto request = in_flight_.find(index);
+  if (request == in_flight_.end()) {
+    in_flight_[index] = ParamRequest{now, 0, 0};
+  } else {
+    request->second.send_time = now;
+    request->second.retries++;
+    request->second.later_replies = 0;
+    num_retransmissions_++;
+  }
+
+  num_requests_++;
+  request_param(index);
+}
+
+void ParamManager::queue_missing_params()
+{
+  pending_.clear();
+  for (int i = 0; i < num_params_; i++) {
+    if (!received_[i] && in_flight_.find(i) == in_flight_.end()) {
+      pending_.push_back(i);
+    }
+  }
+}
+
+void ParamManager::update_rtt(std::chrono::steady_clock::duration rtt)
+{
+  // RFC 6298 estimator
+  double rtt_ms = std::chrono::duration<double, std::milli>(rtt).count();
+  if (!have_rtt_) {
+    srtt_ms_ = rtt_ms;
+    rttvar_ms_ = rtt_ms / 2.0;
+    have_rtt_ = true;
+  } else {
+    rttvar_ms_ = 0.75 * rttvar_ms_ + 0.25 * std::abs(srtt_ms_ - rtt_ms);
+    srtt_ms_ = 0.875 * srtt_ms_ + 0.125 * rtt_ms;
+  }
+  rto_ms_ = std::min(std::max(srtt_ms_ + 4.0 * rttvar_ms_, (double) MIN_RTO.count()),
+                     (double) MAX_RTO.count());
+}
+
+std::chrono::steady_clock::duration ParamManager::retransmit_timeout(int retries) const
+{
+  double timeout_ms = std::min(rto_ms_ * std::pow(2.0, retries), (double) MAX_RTO.count());
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double, std::milli>(timeout_ms));
+}
 
 void ParamManager::param_set_timer_callback()
 {
-  if (param_set_queue_.empty()) {
+  std::lock_guard<std::recursive_mutex> lock(params_mutex_);
+  if (pending_sets_.empty()) {
     param_set_timer_->cancel();
     param_set_in_progress_ = false;
-  } else {
-    comm_->send_message(param_set_queue_.front());
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration timeout[MAX_SET_RETRIES + 1];
+  {
+    std::lock_guard<std::mutex> download_lock(download_mutex_);
+    for (int i = 0; i <= MAX_SET_RETRIES; i++) { timeout[i] = retransmit_timeout(i); }
+  }
+
+  for (auto set = pending_sets_.begin(); set != pending_sets_.end();) {
+    auto current = set++;
+    if (current->second.in_flight
+        && now - current->second.send_time
+          > timeout[std::min(current->second.retries, MAX_SET_RETRIES)]) {
+      retry_set(current, now);
+    }
+  }
+  fill_upload_window(now);
+}
+
+void ParamManager::fill_upload_window(std::chrono::steady_clock::time_point now)
+{
+  while (sets_in_flight_ < UPLOAD_WINDOW && !param_set_queue_.empty()) {
+    auto set = pending_sets_.find(param_set_queue_.front());
     param_set_queue_.pop_front();
+    if (set != pending_sets_.end() && !set->second.in_flight) {
+      set->second.in_flight = true;
+      set->second.send_time = now;
+      sets_in_flight_++;
+      comm_->send_message(set->second.msg);
+    }
+  }
+}
+
+bool ParamManager::retry_set(std::map<int, ParamSet>::iterator set,
+                             std::chrono::steady_clock::time_point now)
+{
+  if (set->second.retries >= MAX_SET_RETRIES) {
+    finish_set(set, false);
+    fill_upload_window(now);
+    return false;
+  }
+
+  set->second.retries++;
+  set->second.send_time = now;
+  num_set_retransmissions_++;
+  comm_->send_message(set->second.msg);
+  return true;
+}
+
+void ParamManager::finish_set(std::map<int, ParamSet>::iterator set, bool success)
+{
+  int index = set->first;
+  const std::string & name = params_[index].getName();
+  double value = params_[index].getValue();
+  if (success) {
+    RCLCPP_DEBUG(node_->get_logger(), "Set parameter %s to %g", name.c_str(), value);
+  } else {
+    RCLCPP_WARN(node_->get_logger(), "Failed to set parameter %s to %g, autopilot reports %g",
+                name.c_str(), set->second.value, value);
+    failed_sets_.insert(index);
+  }
+
+  for (auto & listener : listeners_) { listener->on_param_set_result(name, success, value); }
+
+  if (set->second.in_flight) {
+    sets_in_flight_--;
+  }
+  pending_sets_.erase(set);
+
+  // final report once the whole upload is done
+  if (pending_sets_.empty()) {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - upload_start_)
+                       .count();
+    if (failed_sets_.empty()) {
+      RCLCPP_INFO(node_->get_logger(), "Set %zu parameters in %0.2f s (%zu retransmitted)",
+                  num_sets_, elapsed, num_set_retransmissions_);
+    } else {
+      std::string failed;
+      for (int failed_index : failed_sets_) {
+        failed += (failed.empty() ? "" : ", ") + params_[failed_index].getName();
+      }
+      RCLCPP_WARN(node_->get_logger(),
+                  "Set %zu of %zu parameters in %0.2f s (%zu retransmitted), failed: %s",
+                  num_sets_ - failed_sets_.size(), num_sets_, elapsed, num_set_retransmissions_,
+                  failed.c_str());
+    }
   }
 }
 
@@ -33,22 +33,50 @@
  * \file time_manager.cpp
  * \author Daniel Koch <daniel.koch@byu.edu>
  */
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <vector>
 
 #include <rosflight_io/mavrosflight/time_manager.hpp>
 
 namespace mavrosflight
 {
+namespace
+{
+/**
+ * \brief Median of a vector, reordering its elements
+ */
+double median(std::vector<double> & values)
+{
+  size_t mid = values.size() / 2;
+  std::nth_element(values.begin(), values.begin() + mid, values.end());
+  return values[mid];
+}
+} // namespace
+
 TimeManager::TimeManager(MavlinkComm * const comm, rclcpp::Node * const node)
     : comm_(comm)
     , node_(node)
-    , offset_alpha_(0.95)
-    , offset_ns_(0)
+    , ref_fcu_ns_(0)
+    , ref_offset_ns_(0)
+    , fit_offset_ns_(0.0)
+    , skew_(0.0)
+    , residual_ns_(0.0)
+    , min_rtt_ns_(0)
+    , num_fit_samples_(0)
     , initialized_(false)
+    , synchronized_(false)
+    , consecutive_outliers_(0)
+    , num_outliers_(0)
+    , num_resets_(0)
+    , sync_period_(FAST_SYNC_PERIOD)
+    , next_sync_time_(std::chrono::steady_clock::now())
 {
   comm_->register_mavlink_listener(this);
+  // Runs at the fastest sync rate, and skips ticks while the sync rate is backed off
   time_sync_timer_ = node_->create_wall_timer(
-    std::chrono::milliseconds(100), std::bind(&TimeManager::timer_callback, this), nullptr);
+    FAST_SYNC_PERIOD, std::bind(&TimeManager::timer_callback, this), nullptr);
 }
 
 void TimeManager::handle_mavlink_message(const mavlink_message_t & msg)
@@ -59,53 +87,192 @@ void TimeManager::handle_mavlink_message(const mavlink_message_t & msg)
     mavlink_timesync_t tsync;
     mavlink_msg_timesync_decode(&msg, &tsync);
 
-    std::chrono::nanoseconds tc1_chrono(tsync.tc1);
-
     if (tsync.tc1 > 0) // check that this is a response, not a request
     {
-      std::chrono::nanoseconds ts1_chrono(tsync.ts1);
-      std::chrono::nanoseconds offset_ns((ts1_chrono + now - 2 * tc1_chrono) / 2);
-
-      // if difference > 10ms, use it directly
-      if (!initialized_ || (offset_ns_ - offset_ns) > std::chrono::milliseconds(10)
-          || (offset_ns_ - offset_ns) < std::chrono::milliseconds(-10)) {
-        RCLCPP_INFO(node_->get_logger(), "Detected time offset of %0.3f s.",
-                    abs(std::chrono::duration<double>(offset_ns_ - offset_ns).count()));
-        RCLCPP_DEBUG(node_->get_logger(), "FCU time: %0.3f, System time: %0.3f", tsync.tc1 * 1e-9,
-                     tsync.ts1 * 1e-9);
-        offset_ns_ = offset_ns;
-        initialized_ = true;
-      } else // otherwise low-pass filter the offset
-      {
-        offset_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-          offset_alpha_ * offset_ns + (1.0 - offset_alpha_) * offset_ns_);
+      Sample sample;
+      sample.fcu_ns = tsync.tc1;
+      sample.offset_ns = (tsync.ts1 + now.count() - 2 * tsync.tc1) / 2;
+      sample.rtt_ns = now.count() - tsync.ts1;
+
+      // ignore replies to requests from a previous run, or to requests made before a clock change
+      if (sample.rtt_ns < 0) {
+        return;
       }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      add_sample(sample);
     }
   }
 }
 
 std::chrono::nanoseconds TimeManager::fcu_time_to_system_time(std::chrono::nanoseconds fcu_time)
 {
+  std::unique_lock<std::mutex> lock(mutex_);
   if (!initialized_) {
     return std::chrono::nanoseconds(node_->get_clock()->now().nanoseconds());
   }
 
-  std::chrono::nanoseconds ns = fcu_time + offset_ns_;
+  std::chrono::nanoseconds offset_ns(predict_offset(fcu_time.count()));
+  lock.unlock();
+
+  std::chrono::nanoseconds ns = fcu_time + offset_ns;
   if (ns < std::chrono::nanoseconds::zero()) {
     RCLCPP_ERROR_THROTTLE(
       node_->get_logger(), *node_->get_clock(), 1,
       "negative time calculated from FCU: fcu_time=%ld, offset_ns=%ld.  Using system time",
-      fcu_time.count(), offset_ns_.count());
+      fcu_time.count(), offset_ns.count());
     return std::chrono::nanoseconds(node_->get_clock()->now().nanoseconds());
   }
   return ns;
 }
 
+TimeSyncStatus TimeManager::get_sync_status()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TimeSyncStatus status;
+  status.synchronized = synchronized_;
+  status.offset = std::chrono::nanoseconds(
+    initialized_ ? predict_offset(node_->get_clock()->now().nanoseconds() - ref_offset_ns_) : 0);
+  status.skew = skew_;
+  status.min_rtt = std::chrono::nanoseconds(min_rtt_ns_);
+  status.residual = std::chrono::nanoseconds((int64_t) residual_ns_);
+  status.num_samples = num_fit_samples_;
+  status.num_outliers = num_outliers_;
+  status.num_resets = num_resets_;
+  status.sync_period = sync_period_;
+  return status;
+}
+
 void TimeManager::timer_callback()
 {
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (now < next_sync_time_) {
+      return;
+    }
+    next_sync_time_ = now + sync_period_;
+  }
+
   mavlink_message_t msg;
   mavlink_msg_timesync_pack(1, 50, &msg, 0, node_->get_clock()->now().nanoseconds());
   comm_->send_message(msg);
 }
 
+void TimeManager::add_sample(const Sample & sample)
+{
+  if (initialized_) {
+    // An exchange can be off by up to half its round trip time, so only flag it as an outlier if
+    // it disagrees with the fit by more than that
+    double threshold = std::max((double) MIN_OUTLIER_NS, OUTLIER_SIGMAS * residual_ns_);
+    threshold += sample.rtt_ns / 2.0;
+    double error = (double) (sample.offset_ns - predict_offset(sample.fcu_ns));
+
+    if (std::abs(error) > threshold) {
+      num_outliers_++;
+      consecutive_outliers_++;
+      sync_period_ = FAST_SYNC_PERIOD;
+
+      if (consecutive_outliers_ < MAX_CONSECUTIVE_OUTLIERS) {
+        return;
+      }
+
+      // Too many outliers in a row, so the clocks really did jump
+      RCLCPP_INFO(node_->get_logger(), "Detected time offset jump of %0.3f s, resynchronizing.",
+                  std::abs(error) * 1e-9);
+      window_.clear();
+      initialized_ = false;
+      synchronized_ = false;
+      num_resets_++;
+    }
+  }
+  consecutive_outliers_ = 0;
+
+  if (!initialized_) {
+    RCLCPP_INFO(node_->get_logger(), "Detected time offset of %0.3f s.", sample.offset_ns * 1e-9);
+    RCLCPP_DEBUG(node_->get_logger(), "FCU time: %0.3f, RTT: %0.3f ms", sample.fcu_ns * 1e-9,
+                 sample.rtt_ns * 1e-6);
+  }
+
+  window_.push_back(sample);
+  if (window_.size() > WINDOW_SIZE) {
+    window_.pop_front();
+  }
+  fit();
+  initialized_ = true;
+
+  bool was_synchronized = synchronized_;
+  synchronized_ = window_.size() >= MIN_SYNC_SAMPLES && residual_ns_ < SYNCHRONIZED_RESIDUAL_NS;
+  if (synchronized_ && !was_synchronized) {
+    RCLCPP_INFO(node_->get_logger(), "Time synchronized, offset residual %0.3f ms, skew %0.1f ppm",
+                residual_ns_ * 1e-6, skew_ * 1e6);
+  }
+
+  // Back off while converged, speed back up while converging
+  if (synchronized_) {
+    sync_period_ = std::min(std::chrono::duration_cast<std::chrono::nanoseconds>(sync_period_ * 2),
+                            std::chrono::nanoseconds(SLOW_SYNC_PERIOD));
+  } else {
+    sync_period_ = FAST_SYNC_PERIOD;
+  }
+}
+
+void TimeManager::fit()
+{
+  min_rtt_ns_ = window_.front().rtt_ns;
+  for (const Sample & sample : window_) { min_rtt_ns_ = std::min(min_rtt_ns_, sample.rtt_ns); }
+
+  // Exchanges with a longer round trip time were delayed somewhere and have a biased offset
+  int64_t max_rtt_ns = min_rtt_ns_ + std::max(min_rtt_ns_ / 2, MIN_RTT_MARGIN_NS);
+  std::vector<const Sample *> samples;
+  for (const Sample & sample : window_) {
+    if (sample.rtt_ns <= max_rtt_ns) {
+      samples.push_back(&sample);
+    }
+  }
+  num_fit_samples_ = samples.size();
+
+  // Reference everything to the newest sample, so the fit is done on small numbers
+  ref_fcu_ns_ = samples.back()->fcu_ns;
+  ref_offset_ns_ = samples.back()->offset_ns;
+
+  double n = samples.size();
+  double mean_t = 0.0;
+  double mean_offset = 0.0;
+  for (const Sample * sample : samples) {
+    mean_t += (sample->fcu_ns - ref_fcu_ns_) / n;
+    mean_offset += (sample->offset_ns - ref_offset_ns_) / n;
+  }
+
+  double stt = 0.0;
+  double sto = 0.0;
+  for (const Sample * sample : samples) {
+    double dt = (sample->fcu_ns - ref_fcu_ns_) - mean_t;
+    stt += dt * dt;
+    sto += dt * ((sample->offset_ns - ref_offset_ns_) - mean_offset);
+  }
+
+  // Skew is only observable once the samples span enough time
+  int64_t span_ns = samples.back()->fcu_ns - samples.front()->fcu_ns;
+  skew_ = (samples.size() >= 3 && span_ns >= MIN_SKEW_SPAN_NS) ? sto / stt : 0.0;
+  fit_offset_ns_ = mean_offset - skew_ * mean_t;
+
+  // Robust spread of the residuals (scaled median absolute deviation)
+  std::vector<double> residuals;
+  for (const Sample * sample : samples) {
+    double t = sample->fcu_ns - ref_fcu_ns_;
+    residuals.push_back((sample->offset_ns - ref_offset_ns_) - (fit_offset_ns_ + skew_ * t));
+  }
+  double residual_median = median(residuals);
+  for (double & residual : residuals) { residual = std::abs(residual - residual_median); }
+  residual_ns_ = 1.4826 * median(residuals);
+}
+
+int64_t TimeManager::predict_offset(int64_t fcu_ns) const
+{
+  double t = fcu_ns - ref_fcu_ns_;
+  return ref_offset_ns_ + std::llround(fit_offset_ns_ + skew_ * t);
+}
+
 } // namespace mavrosflight
@@ -44,75 +44,145 @@
 #define GIT_VERSION_STRING TOSTRING(ROSFLIGHT_VERSION)
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <rclcpp_components/register_node_macro.hpp>
+#include <rosflight_io/mavrosflight/io_thread_pool.hpp>
 #include <rosflight_io/mavrosflight/mavlink_serial.hpp>
 #include <rosflight_io/mavrosflight/mavlink_udp.hpp>
 #include <rosflight_io/mavrosflight/serial_exception.hpp>
+#include <stdexcept>
 #include <string>
 #include <tf2/LinearMath/Matrix3x3.h>
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 #include <utility>
+#include <vector>
 
 #include <rosflight_io/rosflight_io.hpp>
 
 namespace rosflight_io
 {
-ROSflightIO::ROSflightIO()
-    : Node("rosflight_io")
+namespace
+{
+/// "param_set_many" request and parameter index whose set is being issued on this thread, the id
+/// is 0 when no set is being issued.
+thread_local uint64_t issuing_param_set_many_id = 0;
+thread_local size_t issuing_param_set_many_index = 0;
+/// True while the ROS parameter mirror writes firmware values on this thread, so the writes are not
+/// sent back to the firmware.
+thread_local bool updating_param_mirror = false;
+} // namespace
+
+ROSflightIO::ROSflightIO(const rclcpp::NodeOptions & options)
+    : Node("rosflight_io", options)
     , prev_status_()
+    , imu_filter_(7)
+    , mag_filter_(3)
 {
+  // Separate callback groups keep slow services (e.g. file I/O) from delaying control inputs when
+  // running with a multi-threaded executor
+  control_callback_group_ =
+    this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  service_callback_group_ =
+    this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  timer_callback_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+
+  rclcpp::SubscriptionOptions control_sub_options;
+  control_sub_options.callback_group = control_callback_group_;
   command_sub_ = this->create_subscription<rosflight_msgs::msg::Command>(
-    "command", 1, std::bind(&ROSflightIO::commandCallback, this, std::placeholders::_1));
+    "command", 1, std::bind(&ROSflightIO::commandCallback, this, std::placeholders::_1),
+    control_sub_options);
   aux_command_sub_ = this->create_subscription<rosflight_msgs::msg::AuxCommand>(
-    "aux_command", 1, std::bind(&ROSflightIO::auxCommandCallback, this, std::placeholders::_1));
+    "aux_command", 1, std::bind(&ROSflightIO::auxCommandCallback, this, std::placeholders::_1),
+    control_sub_options);
   extatt_sub_ = this->create_subscription<rosflight_msgs::msg::Attitude>(
     "external_attitude", 1,
-    std::bind(&ROSflightIO::externalAttitudeCallback, this, std::placeholders::_1));
+    std::bind(&ROSflightIO::externalAttitudeCallback, this, std::placeholders::_1),
+    control_sub_options);
+
+  // Intra-process communication does not support transient local durability
+  rclcpp::PublisherOptions latched_pub_options;
+  latched_pub_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
 
   rclcpp::QoS qos_transient_local_1_(1);
   qos_transient_local_1_.transient_local();
-  unsaved_params_pub_ =
-    this->create_publisher<std_msgs::msg::Bool>("unsaved_params", qos_transient_local_1_);
+  unsaved_params_pub_ = this->create_publisher<std_msgs::msg::Bool>(
+    "unsaved_params", qos_transient_local_1_, latched_pub_options);
   rclcpp::QoS qos_transient_local_5_(5); // A relatively large queue so all messages get through
   qos_transient_local_5_.transient_local();
-  error_pub_ =
-    this->create_publisher<rosflight_msgs::msg::Error>("rosflight_errors", qos_transient_local_5_);
+  error_pub_ = this->create_publisher<rosflight_msgs::msg::Error>(
+    "rosflight_errors", qos_transient_local_5_, latched_pub_options);
 
   param_get_srv_ = this->create_service<rosflight_msgs::srv::ParamGet>(
     "param_get",
     std::bind(&ROSflightIO::paramGetSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
+  param_changes_srv_ = this->create_service<rosflight_msgs::srv::ParamChanges>(
+    "param_changes",
+    std::bind(&ROSflightIO::paramChangesSrvCallback, this, std::placeholders::_1,
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   param_set_srv_ = this->create_service<rosflight_msgs::srv::ParamSet>(
     "param_set",
     std::bind(&ROSflightIO::paramSetSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
+  param_get_many_srv_ = this->create_service<rosflight_msgs::srv::ParamGetMany>(
+    "param_get_many",
+    std::bind(&ROSflightIO::paramGetManySrvCallback, this, std::placeholders::_1,
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
+  param_set_many_srv_ = this->create_service<rosflight_msgs::srv::ParamSetMany>(
+    "param_set_many",
+    // a lambda, since a bind expression would also match the signature with a response argument
+    [this](const std::shared_ptr<rmw_request_id_t> header,
+           const std::shared_ptr<rosflight_msgs::srv::ParamSetMany::Request> req) {
+      paramSetManySrvCallback(header, req);
+    },
+    rmw_qos_profile_services_default, service_callback_group_);
   param_write_srv_ = this->create_service<std_srvs::srv::Trigger>(
     "param_write",
     std::bind(&ROSflightIO::paramWriteSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   param_save_to_file_srv_ = this->create_service<rosflight_msgs::srv::ParamFile>(
     "param_save_to_file",
     std::bind(&ROSflightIO::paramSaveToFileCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   param_load_from_file_srv_ = this->create_service<rosflight_msgs::srv::ParamFile>(
     "param_load_from_file",
     std::bind(&ROSflightIO::paramLoadFromFileCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
+  param_diff_file_srv_ = this->create_service<rosflight_msgs::srv::ParamDiff>(
+    "param_diff_file",
+    std::bind(&ROSflightIO::paramDiffFileCallback, this, std::placeholders::_1,
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   imu_calibrate_bias_srv_ = this->create_service<std_srvs::srv::Trigger>(
     "calibrate_imu",
     std::bind(&ROSflightIO::calibrateImuBiasSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   calibrate_rc_srv_ = this->create_service<std_srvs::srv::Trigger>(
     "calibrate_rc_trim",
     std::bind(&ROSflightIO::calibrateRCTrimSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   reboot_srv_ = this->create_service<std_srvs::srv::Trigger>(
     "reboot",
-    std::bind(&ROSflightIO::rebootSrvCallback, this, std::placeholders::_1, std::placeholders::_2));
+    std::bind(&ROSflightIO::rebootSrvCallback, this, std::placeholders::_1, std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
   reboot_bootloader_srv_ = this->create_service<std_srvs::srv::Trigger>(
     "reboot_to_bootloader",
     std::bind(&ROSflightIO::rebootToBootloaderSrvCallback, this, std::placeholders::_1,
-              std::placeholders::_2));
+              std::placeholders::_2),
+    rmw_qos_profile_services_default, service_callback_group_);
 
   this->declare_parameter("udp", rclcpp::PARAMETER_BOOL);
   this->declare_parameter("bind_host", rclcpp::PARAMETER_STRING);
@@ -122,6 +192,47 @@ ROSflightIO::ROSflightIO()
   this->declare_parameter("port", rclcpp::PARAMETER_STRING);
   this->declare_parameter("baud_rate", rclcpp::PARAMETER_INTEGER);
   this->declare_parameter("frame_id", rclcpp::PARAMETER_STRING);
+  this->declare_parameter("imu_batch_size", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("imu_batch_max_latency_ms", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("imu_rate_hz", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("imu_stamp_smoothing", rclcpp::PARAMETER_BOOL);
+  this->declare_parameter("mag_rate_hz", rclcpp::PARAMETER_DOUBLE);
+  // Only used by the standalone rosflight_io executable, a component container has its own executor
+  // and threads
+  this->declare_parameter("executor_type", rclcpp::PARAMETER_STRING);
+  this->declare_parameter("executor_threads", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("realtime_priority", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("cpu_affinity", rclcpp::PARAMETER_INTEGER_ARRAY);
+  this->declare_parameter("lock_memory", rclcpp::PARAMETER_BOOL);
+  this->declare_parameter("latency_tracing", rclcpp::PARAMETER_BOOL);
+  this->declare_parameter("command_rate_hz", rclcpp::PARAMETER_DOUBLE);
+  this->declare_parameter("command_timeout_ms", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("io_threads", rclcpp::PARAMETER_INTEGER);
+  this->declare_parameter("param_cache_dir", rclcpp::PARAMETER_STRING);
+  this->declare_parameter("mirror_params", rclcpp::PARAMETER_BOOL);
+  this->declare_parameter("push_param_overrides", rclcpp::PARAMETER_BOOL);
+
+  // Output rates and IMU batching need to be configured before any sensor messages can arrive
+  imu_filter_.set_rate(this->get_parameter_or<double>("imu_rate_hz", 0.0));
+  mag_filter_.set_rate(this->get_parameter_or<double>("mag_rate_hz", 0.0));
+  imu_stamp_smoothing_ = this->get_parameter_or("imu_stamp_smoothing", true);
+  imu_batch_size_ = std::max(this->get_parameter_or<int>("imu_batch_size", 0), 0);
+  int imu_batch_max_latency_ms = this->get_parameter_or<int>("imu_batch_max_latency_ms", 20);
+  imu_batch_max_latency_ = std::chrono::milliseconds(std::max(imu_batch_max_latency_ms, 1));
+  if (imu_batch_size_ > 0) {
+    imu_batch_pub_ = this->create_publisher<rosflight_msgs::msg::ImuBatch>("imu/batch", 1);
+    imu_batch_timer_ = this->create_wall_timer(
+      imu_batch_max_latency_ / 2, std::bind(&ROSflightIO::imuBatchTimerCallback, this),
+      timer_callback_group_);
+  }
+
+  // By default each link runs its IO on its own thread. When several instances share a process
+  // (e.g. one component container serving many vehicles), they can share a pool of threads instead
+  std::shared_ptr<mavrosflight::IoThreadPool> io_pool;
+  int io_threads = this->get_parameter_or<int>("io_threads", 0);
+  if (io_threads > 0) {
+    io_pool = mavrosflight::IoThreadPool::get_shared(io_threads);
+  }
 
   if (this->get_parameter_or("udp", false)) {
     auto bind_host = this->get_parameter_or<std::string>("bind_host", "localhost");
@@ -132,7 +243,8 @@ ROSflightIO::ROSflightIO()
     RCLCPP_INFO(this->get_logger(), "Connecting over UDP to \"%s:%d\", from \"%s:%d\"",
                 remote_host.c_str(), remote_port, bind_host.c_str(), bind_port);
 
-    mavlink_comm_ = new mavrosflight::MavlinkUDP(bind_host, bind_port, remote_host, remote_port);
+    mavlink_comm_ =
+      new mavrosflight::MavlinkUDP(bind_host, bind_port, remote_host, remote_port, io_pool);
   } else {
     auto port = this->get_parameter_or<std::string>("port", "/dev/ttyACM0");
     int baud_rate = this->get_parameter_or<int>("baud_rate", 921600);
@@ -140,30 +252,80 @@ ROSflightIO::ROSflightIO()
     RCLCPP_INFO(this->get_logger(), "Connecting to serial port \"%s\", at %d baud", port.c_str(),
                 baud_rate);
 
-    mavlink_comm_ = new mavrosflight::MavlinkSerial(port, baud_rate);
+    mavlink_comm_ = new mavrosflight::MavlinkSerial(port, baud_rate, io_pool);
   }
 
+  // Let the exception propagate instead of shutting down rclcpp, which would also take down any
+  // other nodes running in the same process
   try {
     mavrosflight_ = new mavrosflight::MavROSflight(*mavlink_comm_, this);
   } catch (const mavrosflight::SerialException & e) {
     RCLCPP_FATAL(this->get_logger(), "%s", e.what());
-    rclcpp::shutdown();
+    delete mavlink_comm_;
+    throw;
+  }
+
+  // The firmware params are mirrored as ROS params, so standard parameter tools can reach them
+  mirror_params_ = this->get_parameter_or("mirror_params", false);
+  push_param_overrides_ = this->get_parameter_or("push_param_overrides", false);
+  if (mirror_params_) {
+    parameters_callback_handle_ = this->add_on_set_parameters_callback(
+      std::bind(&ROSflightIO::parametersCallback, this, std::placeholders::_1));
+    param_mirror_timer_ = this->create_wall_timer(
+      std::chrono::milliseconds(PARAM_MIRROR_PERIOD_MS),
+      std::bind(&ROSflightIO::paramMirrorTimerCallback, this), timer_callback_group_);
   }
 
   mavrosflight_->comm.register_mavlink_listener(this);
   mavrosflight_->param.register_param_listener(this);
 
-  // request the param list
+  if (this->get_parameter_or("latency_tracing", false)) {
+    latency_tracker_ = std::make_unique<LatencyTracker>(LATENCY_WINDOW_SIZE);
+    command_latency_pub_ =
+      this->create_publisher<rosflight_msgs::msg::CommandLatency>("command_latency", 10);
+    latency_histogram_pub_ = this->create_publisher<rosflight_msgs::msg::LatencyHistogram>(
+      "command_latency/histograms", LatencyTracker::NUM_STAGES);
+    latency_timer_ =
+      this->create_wall_timer(std::chrono::seconds(LATENCY_PERIOD),
+                              std::bind(&ROSflightIO::latencyTimerCallback, this),
+                              timer_callback_group_);
+    mavrosflight_->comm.register_write_listener(this);
+  }
+
+  // Command scheduler, which sends the latest setpoints at a fixed rate instead of on arrival
+  double command_rate_hz = this->get_parameter_or<double>("command_rate_hz", 0.0);
+  command_timeout_ =
+    std::chrono::milliseconds(this->get_parameter_or<int>("command_timeout_ms", 100));
+  if (command_rate_hz > 0.0) {
+    RCLCPP_INFO(this->get_logger(), "Sending commands at %g Hz", command_rate_hz);
+    command_timer_ = this->create_wall_timer(
+      std::chrono::nanoseconds(static_cast<int64_t>(1e9 / command_rate_hz)),
+      std::bind(&ROSflightIO::commandTimerCallback, this), control_callback_group_);
+  }
+
+  // Parameters are cached per node name, MAVLink ids and firmware version, so reconnecting can skip
+  // the download. An empty directory disables the cache.
+  std::string default_param_cache_dir;
+  if (const char * ros_home = std::getenv("ROS_HOME")) {
+    default_param_cache_dir = std::string(ros_home) + "/rosflight/param_cache";
+  } else if (const char * home = std::getenv("HOME")) {
+    default_param_cache_dir = std::string(home) + "/.ros/rosflight/param_cache";
+  }
+  auto param_cache_dir =
+    this->get_parameter_or<std::string>("param_cache_dir", default_param_cache_dir);
+  if (!param_cache_dir.empty()) {
+    mavrosflight_->param.enable_cache(param_cache_dir, this->get_fully_qualified_name());
+  }
+
+  // request the param list, the param manager retries and reports progress until it is complete
   mavrosflight_->param.request_params();
-  param_timer_ =
-    this->create_wall_timer(std::chrono::seconds(PARAMETER_PERIOD),
-                            std::bind(&ROSflightIO::paramTimerCallback, this), nullptr);
 
   // request version information
   request_version();
   version_timer_ =
     this->create_wall_timer(std::chrono::seconds(VERSION_PERIOD),
-                            std::bind(&ROSflightIO::versionTimerCallback, this), nullptr);
+                            std::bind(&ROSflightIO::versionTimerCallback, this),
+                            timer_callback_group_);
 
   // initialize latched "unsaved parameters" message value
   std_msgs::msg::Bool unsaved_msg;
@@ -180,10 +342,18 @@ ROSflightIO::ROSflightIO()
   prev_status_.control_mode = OFFBOARD_CONTROL_MODE_ENUM_END;
   prev_status_.error_code = ROSFLIGHT_ERROR_NONE;
 
+  // Report the time synchronization quality
+  time_sync_pub_ = this->create_publisher<rosflight_msgs::msg::TimeSyncStatus>("time_sync", 1);
+  time_sync_timer_ =
+    this->create_wall_timer(std::chrono::seconds(TIME_SYNC_STATUS_PERIOD),
+                            std::bind(&ROSflightIO::timeSyncTimerCallback, this),
+                            timer_callback_group_);
+
   // Start the heartbeat
   heartbeat_timer_ =
     this->create_wall_timer(std::chrono::seconds(HEARTBEAT_PERIOD),
-                            std::bind(&ROSflightIO::heartbeatTimerCallback, this), nullptr);
+                            std::bind(&ROSflightIO::heartbeatTimerCallback, this),
+                            timer_callback_group_);
 }
 
 ROSflightIO::~ROSflightIO()
@@ -266,14 +436,67 @@ void ROSflightIO::handle_mavlink_message(const mavlink_message_t & msg)
   }
 }
 
+void ROSflightIO::on_message_written(uint32_t msgid,
+                                     std::chrono::steady_clock::time_point enqueue_time,
+                                     std::chrono::steady_clock::time_point write_time)
+{
+  if (latency_tracker_ != nullptr && msgid == MAVLINK_MSG_ID_OFFBOARD_CONTROL) {
+    latency_tracker_->command_written(enqueue_time, write_time);
+  }
+}
+
 void ROSflightIO::on_new_param_received(std::string name, double value)
 {
   RCLCPP_DEBUG(this->get_logger(), "Got parameter %s with value %g", name.c_str(), value);
+  queue_param_mirror_update(name, value);
 }
 
 void ROSflightIO::on_param_value_updated(std::string name, double value)
 {
   RCLCPP_INFO(this->get_logger(), "Parameter %s has new value %g", name.c_str(), value);
+  queue_param_mirror_update(name, value);
+}
+
+void ROSflightIO::on_param_set_result(std::string name, bool success, double value)
+{
+  queue_param_mirror_update(name, value);
+
+  std::lock_guard<std::mutex> lock(pending_param_sets_mutex_);
+  for (auto pending = pending_param_sets_.begin(); pending != pending_param_sets_.end();) {
+    for (size_t i = 0; i < pending->names.size(); i++) {
+      // Once a set is issued, every result is for it or for a later set that replaced it
+      if (pending->waiting[i] && pending->issued[i] && pending->names[i] == name) {
+        pending->waiting[i] = false;
+        pending->num_waiting--;
+        pending->response.confirmed[i] = success && value == pending->requested[i];
+        pending->response.values[i] = value;
+      }
+    }
+
+    if (pending->num_waiting == 0) {
+      sendParamSetManyResponse(*pending);
+      pending = pending_param_sets_.erase(pending);
+    } else {
+      pending++;
+    }
+  }
+}
+
+void ROSflightIO::on_param_set_requested(std::string name, double value)
+{
+  if (issuing_param_set_many_id == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(pending_param_sets_mutex_);
+  for (auto & pending : pending_param_sets_) {
+    size_t i = issuing_param_set_many_index;
+    if (pending.id == issuing_param_set_many_id && pending.names[i] == name) {
+      pending.issued[i] = true;
+      pending.requested[i] = value;
+      break;
+    }
+  }
 }
 
 void ROSflightIO::on_params_saved_change(bool unsaved_changes)
@@ -436,23 +659,14 @@ void ROSflightIO::handle_statustext_msg(const mavlink_message_t & msg)
 
 void ROSflightIO::handle_attitude_quaternion_msg(const mavlink_message_t & msg)
 {
-  mavlink_attitude_quaternion_t attitude;
-  mavlink_msg_attitude_quaternion_decode(&msg, &attitude);
+  auto attitude_msg = std::make_unique<AttitudeSample>();
+  mavlink_msg_attitude_quaternion_decode(&msg, &attitude_msg->attitude);
+  const mavlink_attitude_quaternion_t & attitude = attitude_msg->attitude;
 
-  rosflight_msgs::msg::Attitude attitude_msg;
-
-  attitude_msg.header.stamp =
-    fcu_time_to_ros_time(std::chrono::milliseconds(attitude.time_boot_ms));
-  attitude_msg.attitude.w = attitude.q1;
-  attitude_msg.attitude.x = attitude.q2;
-  attitude_msg.attitude.y = attitude.q3;
-  attitude_msg.attitude.z = attitude.q4;
-  attitude_msg.angular_velocity.x = attitude.rollspeed;
-  attitude_msg.angular_velocity.y = attitude.pitchspeed;
-  attitude_msg.angular_velocity.z = attitude.yawspeed;
+  attitude_msg->stamp = fcu_time_to_ros_time(std::chrono::milliseconds(attitude.time_boot_ms));
 
   geometry_msgs::msg::Vector3Stamped euler_msg;
-  euler_msg.header.stamp = attitude_msg.header.stamp;
+  euler_msg.header.stamp = attitude_msg->stamp;
 
   tf2::Quaternion quat(attitude.q2, attitude.q3, attitude.q4, attitude.q1);
   tf2::Matrix3x3(quat).getEulerYPR(euler_msg.vector.z, euler_msg.vector.y, euler_msg.vector.x);
@@ -461,12 +675,12 @@ void ROSflightIO::handle_attitude_quaternion_msg(const mavlink_message_t & msg)
   attitude_quat_ = tf2::toMsg(quat);
 
   if (attitude_pub_ == nullptr) {
-    attitude_pub_ = this->create_publisher<rosflight_msgs::msg::Attitude>("attitude", 1);
+    attitude_pub_ = this->create_publisher<AttitudeTypeAdapter>("attitude", 1);
   }
   if (euler_pub_ == nullptr) {
     euler_pub_ = this->create_publisher<geometry_msgs::msg::Vector3Stamped>("attitude/euler", 1);
   }
-  attitude_pub_->publish(attitude_msg);
+  attitude_pub_->publish(std::move(attitude_msg));
   euler_pub_->publish(euler_msg);
 }
 
@@ -474,27 +688,96 @@ void ROSflightIO::handle_small_imu_msg(const mavlink_message_t & msg)
 {
   mavlink_small_imu_t imu;
   mavlink_msg_small_imu_decode(&msg, &imu);
+  rclcpp::Time stamp = fcu_time_to_ros_time(std::chrono::microseconds(imu.time_boot_us));
+
+  if (imu_stamp_smoothing_) {
+    uint64_t dropped_samples;
+    std::chrono::nanoseconds smoothed_stamp = imu_stamp_smoother_.update(
+      std::chrono::microseconds(imu.time_boot_us), std::chrono::nanoseconds(stamp.nanoseconds()),
+      dropped_samples);
+    stamp = rclcpp::Time(smoothed_stamp.count());
+
+    if (dropped_samples > 0) {
+      RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), 1000,
+                           "Detected %lu dropped IMU samples", (unsigned long) dropped_samples);
+
+      std_msgs::msg::UInt32 dropped_msg;
+      dropped_msg.data = (uint32_t) dropped_samples;
+      if (imu_dropped_pub_ == nullptr) {
+        imu_dropped_pub_ =
+          this->create_publisher<std_msgs::msg::UInt32>("imu/dropped_samples", 10);
+      }
+      imu_dropped_pub_->publish(dropped_msg);
+    }
+  }
 
-  sensor_msgs::msg::Imu imu_msg;
-  imu_msg.header.stamp = fcu_time_to_ros_time(std::chrono::microseconds(imu.time_boot_us));
-  imu_msg.header.frame_id = frame_id_;
-  imu_msg.linear_acceleration.x = imu.xacc;
-  imu_msg.linear_acceleration.y = imu.yacc;
-  imu_msg.linear_acceleration.z = imu.zacc;
-  imu_msg.angular_velocity.x = imu.xgyro;
-  imu_msg.angular_velocity.y = imu.ygyro;
-  imu_msg.angular_velocity.z = imu.zgyro;
-  imu_msg.orientation = attitude_quat_;
+  if (imu_batch_size_ > 0) {
+    std::lock_guard<std::mutex> lock(imu_batch_mutex_);
+    if (imu_batch_msg_.stamps.empty()) {
+      imu_batch_start_ = std::chrono::steady_clock::now();
+    }
+
+    geometry_msgs::msg::Vector3 accel;
+    accel.x = imu.xacc;
+    accel.y = imu.yacc;
+    accel.z = imu.zacc;
+    geometry_msgs::msg::Vector3 gyro;
+    gyro.x = imu.xgyro;
+    gyro.y = imu.ygyro;
+    gyro.z = imu.zgyro;
+
+    imu_batch_msg_.stamps.push_back(stamp);
+    imu_batch_msg_.time_boot_us.push_back(imu.time_boot_us);
+    imu_batch_msg_.linear_acceleration.push_back(accel);
+    imu_batch_msg_.angular_velocity.push_back(gyro);
+    imu_batch_msg_.temperature.push_back(imu.temperature);
+
+    // Flush on a full batch, or once the samples span the max latency (e.g. after a rate change)
+    uint64_t batch_span_us = imu.time_boot_us - imu_batch_msg_.time_boot_us.front();
+    if (imu_batch_msg_.stamps.size() >= imu_batch_size_
+        || std::chrono::microseconds(batch_span_us) >= imu_batch_max_latency_) {
+      publish_imu_batch();
+    }
+  }
+
+  // Average down to the requested output rate, if any
+  std::chrono::nanoseconds imu_time = std::chrono::microseconds(imu.time_boot_us);
+  if (imu_filter_.enabled()) {
+    std::array<double, 7> sample = {imu.xacc,  imu.yacc,  imu.zacc,       imu.xgyro,
+                                    imu.ygyro, imu.zgyro, imu.temperature};
+    std::array<double, 7> average;
+    if (!imu_filter_.update(imu_time, sample.data(), imu_time, average.data())) {
+      return;
+    }
+    imu.xacc = (float) average[0];
+    imu.yacc = (float) average[1];
+    imu.zacc = (float) average[2];
+    imu.xgyro = (float) average[3];
+    imu.ygyro = (float) average[4];
+    imu.zgyro = (float) average[5];
+    imu.temperature = (float) average[6];
+    if (imu_stamp_smoothing_) {
+      stamp = rclcpp::Time(imu_stamp_smoother_.to_ros_time(imu_time).count());
+    } else {
+      stamp = fcu_time_to_ros_time(imu_time);
+    }
+  }
+
+  auto imu_msg = std::make_unique<ImuSample>();
+  imu_msg->stamp = stamp;
+  imu_msg->frame_id = frame_id_;
+  imu_msg->imu = imu;
+  imu_msg->orientation = attitude_quat_;
 
   sensor_msgs::msg::Temperature temp_msg;
-  temp_msg.header.stamp = imu_msg.header.stamp;
+  temp_msg.header.stamp = stamp;
   temp_msg.header.frame_id = frame_id_;
   temp_msg.temperature = imu.temperature;
 
   if (imu_pub_ == nullptr) {
-    imu_pub_ = this->create_publisher<sensor_msgs::msg::Imu>("imu/data", 1);
+    imu_pub_ = this->create_publisher<ImuTypeAdapter>("imu/data", 1);
   }
-  imu_pub_->publish(imu_msg);
+  imu_pub_->publish(std::move(imu_msg));
 
   if (imu_temp_pub_ == nullptr) {
     imu_temp_pub_ = this->create_publisher<sensor_msgs::msg::Temperature>("imu/temperature", 1);
@@ -517,6 +800,12 @@ void ROSflightIO::handle_rosflight_output_raw_msg(const mavlink_message_t & msg)
     output_raw_pub_ = this->create_publisher<rosflight_msgs::msg::OutputRaw>("output_raw", 1);
   }
   output_raw_pub_->publish(out_msg);
+
+  if (latency_tracker_ != nullptr) {
+    for (const auto & latency_msg : latency_tracker_->response_received()) {
+      command_latency_pub_->publish(latency_msg);
+    }
+  }
 }
 
 void ROSflightIO::handle_rc_channels_raw_msg(const mavlink_message_t & msg)
@@ -557,7 +846,8 @@ void ROSflightIO::handle_diff_pressure_msg(const mavlink_message_t & msg)
     calibrate_airspeed_srv_ = this->create_service<std_srvs::srv::Trigger>(
       "calibrate_airspeed",
       std::bind(&ROSflightIO::calibrateAirspeedSrvCallback, this, std::placeholders::_1,
-                std::placeholders::_2));
+                std::placeholders::_2),
+      rmw_qos_profile_services_default, service_callback_group_);
   }
 
   if (diff_pressure_pub_ == nullptr) {
@@ -659,7 +949,8 @@ void ROSflightIO::handle_small_baro_msg(const mavlink_message_t & msg)
     calibrate_baro_srv_ = this->create_service<std_srvs::srv::Trigger>(
       "calibrate_baro",
       std::bind(&ROSflightIO::calibrateBaroSrvCallback, this, std::placeholders::_1,
-                std::placeholders::_2));
+                std::placeholders::_2),
+      rmw_qos_profile_services_default, service_callback_group_);
   }
 
   if (baro_pub_ == nullptr) {
@@ -678,6 +969,21 @@ void ROSflightIO::handle_small_mag_msg(const mavlink_message_t & msg)
   mag_msg.header.stamp = this->get_clock()->now();
   mag_msg.header.frame_id = frame_id_;
 
+  // Average down to the requested output rate, if any. The message has no FCU timestamp, so the
+  // windows are aligned to the receive time instead.
+  if (mag_filter_.enabled()) {
+    std::chrono::nanoseconds mag_time(rclcpp::Time(mag_msg.header.stamp).nanoseconds());
+    std::array<double, 3> sample = {mag.xmag, mag.ymag, mag.zmag};
+    std::array<double, 3> average;
+    if (!mag_filter_.update(mag_time, sample.data(), mag_time, average.data())) {
+      return;
+    }
+    mag.xmag = (float) average[0];
+    mag.ymag = (float) average[1];
+    mag.zmag = (float) average[2];
+    mag_msg.header.stamp = rclcpp::Time(mag_time.count());
+  }
+
   mag_msg.magnetic_field.x = mag.xmag;
   mag_msg.magnetic_field.y = mag.ymag;
   mag_msg.magnetic_field.z = mag.zmag;
@@ -728,6 +1034,23 @@ rclcpp::Time ROSflightIO::fcu_time_to_ros_time(std::chrono::nanoseconds fcu_time
   return rclcpp::Time(mavrosflight_->time.fcu_time_to_system_time(fcu_time).count());
 }
 
+void ROSflightIO::publish_imu_batch()
+{
+  if (imu_batch_msg_.stamps.empty()) {
+    return;
+  }
+
+  imu_batch_msg_.header.stamp = imu_batch_msg_.stamps.back();
+  imu_batch_msg_.header.frame_id = frame_id_;
+  imu_batch_pub_->publish(imu_batch_msg_);
+
+  imu_batch_msg_.stamps.clear();
+  imu_batch_msg_.time_boot_us.clear();
+  imu_batch_msg_.linear_acceleration.clear();
+  imu_batch_msg_.angular_velocity.clear();
+  imu_batch_msg_.temperature.clear();
+}
+
 std::string ROSflightIO::get_major_minor_version(const std::string & version)
 {
   size_t start_index = 0;
@@ -750,11 +1073,15 @@ void ROSflightIO::handle_version_msg(const mavlink_message_t & msg)
   version_msg.data = version.version;
 
   if (version_pub_ == nullptr) {
+    rclcpp::PublisherOptions latched_pub_options;
+    latched_pub_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
     rclcpp::QoS qos_transient_local_1_(1);
     qos_transient_local_1_.transient_local();
-    version_pub_ = this->create_publisher<std_msgs::msg::String>("version", qos_transient_local_1_);
+    version_pub_ = this->create_publisher<std_msgs::msg::String>(
+      "version", qos_transient_local_1_, latched_pub_options);
   }
   version_pub_->publish(version_msg);
+  mavrosflight_->param.set_firmware_version(version_msg.data, msg.sysid, msg.compid);
 #ifdef GIT_VERSION_STRING // Macro so that is compiles even if git is not available
   const std::string git_version_string = GIT_VERSION_STRING;
   const std::string rosflight_major_minor_version = get_major_minor_version(git_version_string);
@@ -959,6 +1286,21 @@ void ROSflightIO::commandCallback(const rosflight_msgs::msg::Command::ConstShare
 
   mavlink_message_t mavlink_msg;
   mavlink_msg_offboard_control_pack(1, 50, &mavlink_msg, mode, ignore, x, y, z, F);
+
+  if (command_timer_ != nullptr) {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    scheduled_command_.valid = true;
+    scheduled_command_.traced = false;
+    scheduled_command_.msg = mavlink_msg;
+    scheduled_command_.header_stamp = msg->header.stamp;
+    scheduled_command_.callback_time = this->get_clock()->now();
+    scheduled_command_.receive_time = std::chrono::steady_clock::now();
+    return;
+  }
+
+  if (latency_tracker_ != nullptr) {
+    latency_tracker_->command_received(msg->header.stamp, this->get_clock()->now());
+  }
   mavrosflight_->comm.send_message(mavlink_msg);
 }
 
@@ -986,6 +1328,17 @@ void ROSflightIO::externalAttitudeCallback(
   mavlink_message_t mavlink_msg;
   mavlink_msg_external_attitude_pack(1, 50, &mavlink_msg, (float) attitude.w, (float) attitude.x,
                                      (float) attitude.y, (float) attitude.z);
+
+  if (command_timer_ != nullptr) {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    scheduled_attitude_.valid = true;
+    scheduled_attitude_.msg = mavlink_msg;
+    scheduled_attitude_.header_stamp = msg->header.stamp;
+    scheduled_attitude_.callback_time = this->get_clock()->now();
+    scheduled_attitude_.receive_time = std::chrono::steady_clock::now();
+    return;
+  }
+
   mavrosflight_->comm.send_message(mavlink_msg);
 }
 
@@ -997,6 +1350,108 @@ bool ROSflightIO::paramGetSrvCallback(
   return true;
 }
 
+bool ROSflightIO::paramGetManySrvCallback(
+  const rosflight_msgs::srv::ParamGetMany::Request::SharedPtr & req,
+  const rosflight_msgs::srv::ParamGetMany::Response::SharedPtr & res)
+{
+  res->exists.resize(req->names.size());
+  res->values.resize(req->names.size());
+  for (size_t i = 0; i < req->names.size(); i++) {
+    res->exists[i] = mavrosflight_->param.get_param_value(req->names[i], &res->values[i]);
+  }
+  return true;
+}
+
+void ROSflightIO::paramSetManySrvCallback(
+  const std::shared_ptr<rmw_request_id_t> & header,
+  const rosflight_msgs::srv::ParamSetMany::Request::SharedPtr & req)
+{
+  size_t num_params = req->names.size();
+
+  PendingParamSetMany pending;
+  pending.header = header;
+  pending.names = req->names;
+  pending.waiting.assign(num_params, false);
+  pending.issued.assign(num_params, false);
+  pending.requested.assign(num_params, 0.0);
+  pending.response.exists.assign(num_params, false);
+  pending.response.confirmed.assign(num_params, false);
+  pending.response.values.assign(num_params, 0.0);
+
+  if (req->values.size() != num_params) {
+    RCLCPP_ERROR(this->get_logger(), "param_set_many request has %zu names but %zu values",
+                 num_params, req->values.size());
+    pending.response.success = false;
+    param_set_many_srv_->send_response(*header, pending.response);
+    return;
+  }
+
+  for (size_t i = 0; i < num_params; i++) {
+    double value;
+    if (mavrosflight_->param.get_param_value(req->names[i], &value)) {
+      pending.response.exists[i] = true;
+      pending.response.values[i] = value;
+      pending.waiting[i] = true;
+      pending.num_waiting++;
+    }
+  }
+
+  if (pending.num_waiting == 0) {
+    sendParamSetManyResponse(pending);
+    return;
+  }
+
+  // Register the request before sending any sets, since results can arrive on the MAVLink thread
+  // as soon as the first set goes out. The lock is released first, because results are reported
+  // with the MAVROSflight param lock held.
+  std::vector<bool> exists = pending.waiting;
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(pending_param_sets_mutex_);
+    id = next_param_set_many_id_++;
+    pending.id = id;
+    pending_param_sets_.push_back(std::move(pending));
+  }
+
+  // Each set is marked as issued from inside set_param_value, under the MAVROSflight param lock,
+  // so results of sets that were already in flight can be told apart from the results of these
+  for (size_t i = 0; i < num_params; i++) {
+    if (exists[i]) {
+      issuing_param_set_many_id = id;
+      issuing_param_set_many_index = i;
+      mavrosflight_->param.set_param_value(req->names[i], req->values[i]);
+    }
+  }
+  issuing_param_set_many_id = 0;
+}
+
+void ROSflightIO::sendParamSetManyResponse(PendingParamSetMany & pending)
+{
+  pending.response.success = true;
+  for (size_t i = 0; i < pending.response.exists.size(); i++) {
+    pending.response.success = pending.response.success && pending.response.exists[i]
+      && pending.response.confirmed[i];
+  }
+  param_set_many_srv_->send_response(*pending.header, pending.response);
+}
+
+bool ROSflightIO::paramChangesSrvCallback(
+  const rosflight_msgs::srv::ParamChanges::Request::SharedPtr & req,
+  const rosflight_msgs::srv::ParamChanges::Response::SharedPtr & res)
+{
+  std::vector<mavrosflight::ParamManager::ParamChange> changes;
+  res->complete = mavrosflight_->param.get_changes_since(req->since, &changes, &res->latest);
+
+  for (const auto & change : changes) {
+    res->sequences.push_back(change.sequence);
+    res->names.push_back(change.name);
+    res->old_values.push_back(change.old_value);
+    res->new_values.push_back(change.new_value);
+    res->stamps.push_back(change.time);
+  }
+  return true;
+}
+
 bool ROSflightIO::paramSetSrvCallback(
   const rosflight_msgs::srv::ParamSet::Request::SharedPtr & req,
   const rosflight_msgs::srv::ParamSet::Response::SharedPtr & res)
@@ -1032,6 +1487,22 @@ bool ROSflightIO::paramLoadFromFileCallback(
   return true;
 }
 
+bool ROSflightIO::paramDiffFileCallback(
+  const rosflight_msgs::srv::ParamDiff::Request::SharedPtr & req,
+  const rosflight_msgs::srv::ParamDiff::Response::SharedPtr & res)
+{
+  mavrosflight::ParamManager::ParamFileDiff diff;
+  res->success = mavrosflight_->param.diff_file(req->filename, req->upload, &diff);
+
+  res->changed = diff.changed;
+  res->onboard_values = diff.onboard_values;
+  res->file_values = diff.file_values;
+  res->type_mismatches = diff.type_mismatches;
+  res->missing = diff.missing;
+  res->num_sent = diff.num_sent;
+  return true;
+}
+
 bool ROSflightIO::calibrateImuBiasSrvCallback(
   const std_srvs::srv::Trigger::Request::SharedPtr & req,
   const std_srvs::srv::Trigger::Response::SharedPtr & res)
@@ -1055,22 +1526,180 @@ bool ROSflightIO::calibrateRCTrimSrvCallback(
   return true;
 }
 
-void ROSflightIO::paramTimerCallback()
+void ROSflightIO::versionTimerCallback() { request_version(); }
+
+void ROSflightIO::heartbeatTimerCallback() { send_heartbeat(); }
+
+void ROSflightIO::latencyTimerCallback()
 {
-  if (mavrosflight_->param.got_all_params()) {
-    param_timer_->cancel();
-    RCLCPP_INFO(this->get_logger(), "Received all parameters");
-  } else {
-    mavrosflight_->param.request_params();
-    RCLCPP_ERROR(this->get_logger(),
-                 "Received %d of %d parameters. Requesting missing parameters...",
-                 mavrosflight_->param.get_params_received(), mavrosflight_->param.get_num_params());
+  for (const auto & histogram_msg : latency_tracker_->get_histograms(this->get_clock()->now())) {
+    latency_histogram_pub_->publish(histogram_msg);
   }
 }
 
-void ROSflightIO::versionTimerCallback() { request_version(); }
+void ROSflightIO::commandTimerCallback()
+{
+  auto now = std::chrono::steady_clock::now();
+  long timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(command_timeout_).count();
+  std::lock_guard<std::mutex> lock(command_mutex_);
+
+  if (scheduled_command_.valid) {
+    if (now - scheduled_command_.receive_time <= command_timeout_) {
+      // Only the first transmission of a setpoint is traced, resends of a held setpoint would
+      // measure how long it was held rather than the latency of the command path. The time spent
+      // waiting for the scheduler counts towards the callback to enqueue stage.
+      if (latency_tracker_ != nullptr && !scheduled_command_.traced) {
+        latency_tracker_->command_received(scheduled_command_.header_stamp,
+                                           scheduled_command_.callback_time,
+                                           scheduled_command_.receive_time);
+        scheduled_command_.traced = true;
+      }
+      mavrosflight_->comm.send_message(scheduled_command_.msg);
+      scheduled_command_.stale = false;
+    } else if (!scheduled_command_.stale) {
+      RCLCPP_WARN(this->get_logger(), "No new command received in %ld ms, stopped sending commands",
+                  timeout_ms);
+      scheduled_command_.stale = true;
+    }
+  }
 
-void ROSflightIO::heartbeatTimerCallback() { send_heartbeat(); }
+  if (scheduled_attitude_.valid) {
+    if (now - scheduled_attitude_.receive_time <= command_timeout_) {
+      mavrosflight_->comm.send_message(scheduled_attitude_.msg);
+      scheduled_attitude_.stale = false;
+    } else if (!scheduled_attitude_.stale) {
+      RCLCPP_WARN(this->get_logger(),
+                  "No new external attitude received in %ld ms, stopped sending external attitude",
+                  timeout_ms);
+      scheduled_attitude_.stale = true;
+    }
+  }
+}
+
+void ROSflightIO::timeSyncTimerCallback()
+{
+  mavrosflight::TimeSyncStatus status = mavrosflight_->time.get_sync_status();
+
+  rosflight_msgs::msg::TimeSyncStatus msg;
+  msg.header.stamp = this->get_clock()->now();
+  msg.synchronized = status.synchronized;
+  msg.offset = std::chrono::duration<double>(status.offset).count();
+  msg.skew = status.skew;
+  msg.min_rtt = std::chrono::duration<double>(status.min_rtt).count();
+  msg.residual = std::chrono::duration<double>(status.residual).count();
+  msg.num_samples = status.num_samples;
+  msg.num_outliers = status.num_outliers;
+  msg.num_resets = status.num_resets;
+  msg.sync_period = std::chrono::duration<double>(status.sync_period).count();
+  time_sync_pub_->publish(msg);
+}
+
+void ROSflightIO::imuBatchTimerCallback()
+{
+  std::lock_guard<std::mutex> lock(imu_batch_mutex_);
+  if (!imu_batch_msg_.stamps.empty()
+      && std::chrono::steady_clock::now() - imu_batch_start_ >= imu_batch_max_latency_) {
+    publish_imu_batch();
+  }
+}
+
+void ROSflightIO::paramMirrorTimerCallback()
+{
+  std::map<std::string, double> updates;
+  {
+    std::lock_guard<std::mutex> lock(param_mirror_mutex_);
+    updates.swap(param_mirror_updates_);
+  }
+
+  std::vector<rclcpp::Parameter> changed;
+  for (const auto & update : updates) {
+    if (!this->has_parameter(update.first)) {
+      rcl_interfaces::msg::ParameterDescriptor descriptor;
+      descriptor.description = "ROSflight firmware parameter";
+      rclcpp::ParameterValue declared;
+      updating_param_mirror = true;
+      try {
+        declared = this->declare_parameter(update.first, rclcpp::ParameterValue(update.second),
+                                           descriptor);
+      } catch (const std::runtime_error & e) {
+        RCLCPP_WARN(this->get_logger(), "Could not mirror parameter %s: %s", update.first.c_str(),
+                    e.what());
+      }
+      updating_param_mirror = false;
+
+      // A parameter override for a firmware param only reaches the firmware when explicitly
+      // enabled, otherwise the mirror is put back to the firmware value
+      if (declared.get_type() == rclcpp::ParameterType::PARAMETER_DOUBLE
+          && declared.get<double>() != update.second) {
+        if (push_param_overrides_) {
+          RCLCPP_WARN(this->get_logger(), "Pushing parameter override %s = %g to the firmware",
+                      update.first.c_str(), declared.get<double>());
+          mavrosflight_->param.set_param_value(update.first, declared.get<double>());
+        } else {
+          RCLCPP_WARN(this->get_logger(),
+                      "Ignoring parameter override for firmware parameter %s, set "
+                      "push_param_overrides to send it to the firmware",
+                      update.first.c_str());
+          changed.emplace_back(update.first, update.second);
+        }
+      }
+    } else {
+      rclcpp::Parameter parameter = this->get_parameter(update.first);
+      if (parameter.get_type() == rclcpp::ParameterType::PARAMETER_DOUBLE
+          && parameter.as_double() != update.second) {
+        changed.emplace_back(update.first, update.second);
+      }
+    }
+  }
+
+  if (!changed.empty()) {
+    updating_param_mirror = true;
+    this->set_parameters(changed);
+    updating_param_mirror = false;
+  }
+}
+
+rcl_interfaces::msg::SetParametersResult
+ROSflightIO::parametersCallback(const std::vector<rclcpp::Parameter> & parameters)
+{
+  rcl_interfaces::msg::SetParametersResult result;
+  result.successful = true;
+
+  std::vector<const rclcpp::Parameter *> changed;
+  for (const auto & parameter : parameters) {
+    double firmware_value;
+    if (!mavrosflight_->param.get_param_value(parameter.get_name(), &firmware_value)) {
+      continue; // not a firmware param
+    }
+
+    if (parameter.get_type() != rclcpp::ParameterType::PARAMETER_DOUBLE) {
+      result.successful = false;
+      result.reason = "Firmware parameter " + parameter.get_name() + " must be set as a double";
+      return result;
+    }
+
+    // A user change is sent even if it matches the last confirmed value, since a set of another
+    // value may still be in flight
+    changed.push_back(&parameter);
+  }
+
+  if (updating_param_mirror) {
+    return result;
+  }
+
+  for (const rclcpp::Parameter * parameter : changed) {
+    mavrosflight_->param.set_param_value(parameter->get_name(), parameter->as_double());
+  }
+  return result;
+}
+
+void ROSflightIO::queue_param_mirror_update(const std::string & name, double value)
+{
+  if (mirror_params_) {
+    std::lock_guard<std::mutex> lock(param_mirror_mutex_);
+    param_mirror_updates_[name] = value;
+  }
+}
 
 void ROSflightIO::request_version()
 {
@@ -1140,3 +1769,5 @@ bool ROSflightIO::rebootToBootloaderSrvCallback(
 }
 
 } // namespace rosflight_io
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rosflight_io::ROSflightIO)
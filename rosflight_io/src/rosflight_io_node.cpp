@@ -38,13 +38,105 @@
  * \author Brandon Sutherland <brandonsutherland2@gmail.com>
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <vector>
+
 #include <rclcpp/rclcpp.hpp>
+#include <rosflight_io/mavrosflight/serial_exception.hpp>
 #include <rosflight_io/rosflight_io.hpp>
 
+namespace
+{
+/**
+ * @brief Applies the real-time settings from the node's ROS parameters to the calling thread.
+ *
+ * Locks process memory, sets the CPU affinity, and sets the SCHED_FIFO priority, depending on
+ * the "lock_memory", "cpu_affinity", and "realtime_priority" parameters. Threads created by the
+ * calling thread afterwards inherit the affinity and priority. Failures (usually missing
+ * privileges) are reported as warnings and otherwise ignored. This is only done by the standalone
+ * executable, since it changes the whole process, which would affect the other nodes of a
+ * component container.
+ *
+ * @param node Node to read the parameters from.
+ */
+void configure_realtime(rclcpp::Node & node)
+{
+  if (node.get_parameter_or("lock_memory", false)) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+      RCLCPP_WARN(node.get_logger(), "Failed to lock memory: %s", strerror(errno));
+    } else {
+      RCLCPP_INFO(node.get_logger(), "Locked process memory");
+    }
+  }
+
+  auto cpu_affinity = node.get_parameter_or<std::vector<int64_t>>("cpu_affinity", {});
+  if (!cpu_affinity.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int64_t cpu : cpu_affinity) { CPU_SET(cpu, &cpu_set); }
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (error != 0) {
+      RCLCPP_WARN(node.get_logger(), "Failed to set CPU affinity: %s", strerror(error));
+    }
+  }
+
+  int priority = node.get_parameter_or<int>("realtime_priority", 0);
+  if (priority > 0) {
+    sched_param param;
+    param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+      RCLCPP_WARN(node.get_logger(), "Failed to set SCHED_FIFO priority %d: %s",
+                  param.sched_priority, strerror(error));
+    } else {
+      RCLCPP_INFO(node.get_logger(), "Running with SCHED_FIFO priority %d",
+                  param.sched_priority);
+    }
+  }
+}
+} // namespace
+
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
-  rclcpp::spin(std::make_shared<rosflight_io::ROSflightIO>());
+
+  std::shared_ptr<rosflight_io::ROSflightIO> node;
+  try {
+    node = std::make_shared<rosflight_io::ROSflightIO>();
+  } catch (const mavrosflight::SerialException &) {
+    // already reported by the node
+    rclcpp::shutdown();
+    return 1;
+  }
+
+  // The executor threads are created on this thread, so they inherit the real-time settings
+  configure_realtime(*node);
+
+  auto executor_type = node->get_parameter_or<std::string>("executor_type", "single_threaded");
+  std::shared_ptr<rclcpp::Executor> executor;
+  if (executor_type == "multi_threaded") {
+    int threads = node->get_parameter_or<int>("executor_threads", 0); // 0 uses all cores
+    executor = std::make_shared<rclcpp::executors::MultiThreadedExecutor>(
+      rclcpp::ExecutorOptions(), (size_t) std::max(threads, 0));
+  } else if (executor_type == "static_single_threaded") {
+    executor = std::make_shared<rclcpp::executors::StaticSingleThreadedExecutor>();
+  } else {
+    if (executor_type != "single_threaded") {
+      RCLCPP_WARN(node->get_logger(), "Unknown executor type \"%s\", using single_threaded",
+                  executor_type.c_str());
+    }
+    executor = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+  }
+
+  executor->add_node(node);
+  executor->spin();
   rclcpp::shutdown();
   return 0;
 }
@@ -0,0 +1,136 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file sphere_coverage.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <utility>
+
+#include <rosflight_io/sphere_coverage.hpp>
+
+namespace rosflight_io
+{
+SphereCoverage::SphereCoverage(int subdivisions, size_t samples_per_bin)
+    : num_occupied_(0)
+    , samples_per_bin_(samples_per_bin)
+{
+  // Vertices of an icosahedron are the cyclic permutations of (0, +-1, +-phi)
+  const double phi = (1.0 + std::sqrt(5.0)) / 2.0;
+  centers_ = {{-1, phi, 0}, {1, phi, 0}, {-1, -phi, 0}, {1, -phi, 0},
+              {0, -1, phi}, {0, 1, phi}, {0, -1, -phi}, {0, 1, -phi},
+              {phi, 0, -1}, {phi, 0, 1}, {-phi, 0, -1}, {-phi, 0, 1}};
+  for (Eigen::Vector3d & center : centers_) { center.normalize(); }
+
+  std::vector<std::array<size_t, 3>> faces = {
+    {0, 11, 5}, {0, 5, 1},  {0, 1, 7},   {0, 7, 10}, {0, 10, 11},
+    {1, 5, 9},  {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+    {3, 9, 4},  {3, 4, 2},  {3, 2, 6},   {3, 6, 8},  {3, 8, 9},
+    {4, 9, 5},  {2, 4, 11}, {6, 2, 10},  {8, 6, 7},  {9, 8, 1}};
+
+  // Split each face into four, sharing the new vertex on each edge between its two faces
+  for (int level = 0; level < subdivisions; level++) {
+    std::map<std::pair<size_t, size_t>, size_t> midpoints;
+    auto midpoint = [&](size_t a, size_t b) {
+      auto key = std::minmax(a, b);
+      auto it = midpoints.find(key);
+      if (it != midpoints.end()) {
+        return it->second;
+      }
+      centers_.push_back((centers_[a] + centers_[b]).normalized());
+      midpoints[key] = centers_.size() - 1;
+      return centers_.size() - 1;
+    };
+
+    std::vector<std::array<size_t, 3>> subdivided;
+    subdivided.reserve(4 * faces.size());
+    for (const auto & face : faces) {
+      size_t ab = midpoint(face[0], face[1]);
+      size_t bc = midpoint(face[1], face[2]);
+      size_t ca = midpoint(face[2], face[0]);
+      subdivided.push_back({face[0], ab, ca});
+      subdivided.push_back({face[1], bc, ab});
+      subdivided.push_back({face[2], ca, bc});
+      subdivided.push_back({ab, bc, ca});
+    }
+    faces.swap(subdivided);
+  }
+
+  counts_.assign(centers_.size(), 0);
+}
+
+size_t SphereCoverage::bin(const Eigen::Vector3d & direction) const
+{
+  // The closest center has the largest dot product, normalizing would not change which one it is
+  size_t best = 0;
+  double best_dot = direction.dot(centers_[0]);
+  for (size_t i = 1; i < centers_.size(); i++) {
+    double dot = direction.dot(centers_[i]);
+    if (dot > best_dot) {
+      best = i;
+      best_dot = dot;
+    }
+  }
+  return best;
+}
+
+bool SphereCoverage::add(const Eigen::Vector3d & direction)
+{
+  if (direction.isZero()) {
+    return false;
+  }
+
+  size_t & count = counts_[bin(direction)];
+  if (samples_per_bin_ > 0 && count >= samples_per_bin_) {
+    return false;
+  }
+
+  if (count == 0) {
+    num_occupied_++;
+  }
+  count++;
+  return true;
+}
+
+void SphereCoverage::reset()
+{
+  std::fill(counts_.begin(), counts_.end(), 0);
+  num_occupied_ = 0;
+}
+
+} // namespace rosflight_io
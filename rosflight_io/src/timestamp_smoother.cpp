@@ -0,0 +1,136 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file timestamp_smoother.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <cmath>
+
+#include <rosflight_io/timestamp_smoother.hpp>
+
+namespace rosflight_io
+{
+TimestampSmoother::TimestampSmoother() { reset(); }
+
+std::chrono::nanoseconds TimestampSmoother::update(std::chrono::nanoseconds fcu_time,
+                                                   std::chrono::nanoseconds ros_time,
+                                                   uint64_t & dropped_samples)
+{
+  dropped_samples = 0;
+
+  // Time going backwards means the FCU rebooted, so nothing learned so far applies
+  if (initialized_ && fcu_time <= last_fcu_time_) {
+    reset();
+  }
+
+  if (!initialized_) {
+    anchor(fcu_time, ros_time);
+    initialized_ = true;
+    last_fcu_time_ = fcu_time;
+    last_stamp_ = ros_time;
+    return ros_time;
+  }
+
+  double dt = (fcu_time - last_fcu_time_).count();
+  last_fcu_time_ = fcu_time;
+
+  if (period_ > 0.0 && dt > GAP_THRESHOLD * period_) {
+    // A run of gaps of about the same length means the stream slowed down (e.g. its stream rate
+    // was lowered), so the new interval becomes the period instead of reporting dropped samples
+    if (std::abs(dt - gap_length_) <= RATE_CHANGE_TOLERANCE * gap_length_) {
+      gap_count_++;
+    } else {
+      gap_length_ = dt;
+      gap_count_ = 1;
+    }
+    if (gap_count_ >= RATE_CHANGE_GAPS) {
+      period_ = dt;
+      gap_count_ = 0;
+    } else {
+      dropped_samples = (uint64_t) std::llround(dt / period_) - 1;
+    }
+
+    // Don't smooth across the gap, the stamps before and after it are not comparable
+    anchor(fcu_time, ros_time);
+  } else {
+    gap_count_ = 0;
+    period_ = period_ > 0.0 ? (1.0 - PERIOD_ALPHA) * period_ + PERIOD_ALPHA * dt : dt;
+
+    double predicted = offset_ + offset_rate_ * dt;
+    double error = (ros_time - fcu_time - offset_reference_).count() - predicted;
+    if (std::abs(error) > std::chrono::nanoseconds(MAX_OFFSET_ERROR).count()) {
+      anchor(fcu_time, ros_time);
+    } else {
+      offset_ = predicted + PHASE_GAIN * error;
+      offset_rate_ += FREQUENCY_GAIN * error / dt;
+    }
+  }
+
+  // Stamps must be strictly increasing, even right after re-anchoring
+  std::chrono::nanoseconds stamp = to_ros_time(fcu_time);
+  if (stamp <= last_stamp_) {
+    stamp = last_stamp_ + std::chrono::nanoseconds(1);
+  }
+  last_stamp_ = stamp;
+  return stamp;
+}
+
+std::chrono::nanoseconds TimestampSmoother::to_ros_time(std::chrono::nanoseconds fcu_time) const
+{
+  double offset = offset_ + offset_rate_ * (fcu_time - last_fcu_time_).count();
+  return fcu_time + offset_reference_ + std::chrono::nanoseconds(std::llround(offset));
+}
+
+void TimestampSmoother::reset()
+{
+  initialized_ = false;
+  last_fcu_time_ = std::chrono::nanoseconds(0);
+  last_stamp_ = std::chrono::nanoseconds(0);
+  offset_reference_ = std::chrono::nanoseconds(0);
+  offset_ = 0.0;
+  offset_rate_ = 0.0;
+  period_ = 0.0;
+  gap_length_ = 0.0;
+  gap_count_ = 0;
+}
+
+void TimestampSmoother::anchor(std::chrono::nanoseconds fcu_time, std::chrono::nanoseconds ros_time)
+{
+  offset_reference_ = ros_time - fcu_time;
+  offset_ = 0.0;
+  offset_rate_ = 0.0;
+}
+
+} // namespace rosflight_io
@@ -0,0 +1,88 @@
+/*
+ * Software License Agreement (BSD-3 License)
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file timestamp_smoother_test.cpp
+ * @author agent <agent\@local>
+ */
+
+#include <chrono>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include <rosflight_io/timestamp_smoother.hpp>
+
+namespace
+{
+/// Feeds evenly spaced samples to the smoother, returning the number of dropped samples reported.
+uint64_t feed(rosflight_io::TimestampSmoother & smoother, std::chrono::nanoseconds & time,
+              std::chrono::nanoseconds period, int num_samples)
+{
+  uint64_t total_dropped = 0;
+  for (int i = 0; i < num_samples; i++) {
+    time += period;
+    uint64_t dropped;
+    smoother.update(time, time, dropped);
+    total_dropped += dropped;
+  }
+  return total_dropped;
+}
+} // namespace
+
+TEST(TimestampSmoother, ReportsDroppedSamples)
+{
+  rosflight_io::TimestampSmoother smoother;
+  std::chrono::nanoseconds time(0);
+  std::chrono::nanoseconds period = std::chrono::milliseconds(1);
+  EXPECT_EQ(feed(smoother, time, period, 1000), 0u);
+
+  // skip two samples
+  time += 2 * period;
+  EXPECT_EQ(feed(smoother, time, period, 1000), 2u);
+}
+
+TEST(TimestampSmoother, AdoptsLowerSampleRate)
+{
+  rosflight_io::TimestampSmoother smoother;
+  std::chrono::nanoseconds time(0);
+  EXPECT_EQ(feed(smoother, time, std::chrono::milliseconds(1), 1000), 0u);
+
+  // only the gaps before the new rate is recognized may be reported as drops
+  uint64_t dropped = feed(smoother, time, std::chrono::milliseconds(4), 1000);
+  EXPECT_LE(dropped, (uint64_t) (3 * (rosflight_io::TimestampSmoother::RATE_CHANGE_GAPS - 1)));
+
+  // drops are still detected at the new rate
+  time += std::chrono::milliseconds(4);
+  EXPECT_EQ(feed(smoother, time, std::chrono::milliseconds(4), 100), 1u);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file byte_ring.hpp
+ * \author agent <agent@local>
+ */
+
+#ifndef ROSFLIGHT_SIM_BYTE_RING_HPP
+#define ROSFLIGHT_SIM_BYTE_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace rosflight_sim
+{
+/**
+ * @brief Lock-free byte ring buffer for one producer thread and one consumer thread.
+ *
+ * The producer and consumer each own one of the two positions and only read the other, so no
+ * locks are needed. The positions count bytes since construction and are masked to index the
+ * buffer, which keeps a full ring distinguishable from an empty one.
+ *
+ * @tparam Capacity Size of the buffer in bytes, must be a power of two.
+ */
+template<size_t Capacity>
+class ByteRing
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "ByteRing capacity must be a power of two");
+
+public:
+  /**
+   * @brief Number of bytes that can be read. Safe to call from either thread.
+   */
+  size_t size() const
+  {
+    // load the tail first, so the head can only have moved further and the size is not negative
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return head_.load(std::memory_order_acquire) - tail;
+  }
+
+  /**
+   * @brief Writes a block of bytes, or nothing if it does not fit. Producer thread only.
+   *
+   * @param src Bytes to write.
+   * @param len Number of bytes to write.
+   * @return True if the bytes were written, false if there was not enough space.
+   */
+  bool write(const uint8_t * src, size_t len)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    if (Capacity - (head - tail) < len) {
+      return false;
+    }
+
+    size_t start = head & (Capacity - 1);
+    size_t first = std::min(len, Capacity - start);
+    memcpy(data_ + start, src, first);
+    memcpy(data_, src + first, len - first);
+
+    head_.store(head + len, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Reads up to max_len bytes. Consumer thread only.
+   *
+   * @param dst Buffer to read the bytes into.
+   * @param max_len Size of the buffer.
+   * @return Number of bytes read.
+   */
+  size_t read(uint8_t * dst, size_t max_len)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t len = std::min(max_len, head - tail);
+
+    size_t start = tail & (Capacity - 1);
+    size_t first = std::min(len, Capacity - start);
+    memcpy(dst, data_ + start, first);
+    memcpy(dst + first, data_, len - first);
+
+    tail_.store(tail + len, std::memory_order_release);
+    return len;
+  }
+
+private:
+  /// Position of the next byte to write, owned by the producer. Kept on its own cache line so
+  /// the two threads do not invalidate each other's position on every access.
+  alignas(64) std::atomic<size_t> head_{0};
+  /// Position of the next byte to read, owned by the consumer.
+  alignas(64) std::atomic<size_t> tail_{0};
+  /// Ring buffer storage.
+  alignas(64) uint8_t data_[Capacity];
+};
+
+} // namespace rosflight_sim
+
+#endif // ROSFLIGHT_SIM_BYTE_RING_HPP
@@ -43,6 +43,7 @@
 #include <geometry_msgs/msg/vector3.hpp>
 #include <nav_msgs/msg/odometry.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <std_msgs/msg/float64.hpp>
 
 #include <mavlink/mavlink.h>
 #include <rosflight.h>
@@ -91,6 +92,12 @@ private:
    * Gazebo.
    */
   void publish_truth();
+  /**
+   * @brief Runs the firmware loop at each of its scheduled times up to the current sim time, so the
+   * loop rate follows firmware_loop_rate independently of the physics step size. Publishes the
+   * achieved loop rate once per second of sim time.
+   */
+  void run_firmware();
 
   rclcpp::Node::SharedPtr node_;
 
@@ -111,6 +118,15 @@ private:
 
   rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr truth_NED_pub_;
   rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr truth_NWU_pub_;
+  rclcpp::Publisher<std_msgs::msg::Float64>::SharedPtr loop_rate_pub_;
+
+  // Firmware scheduling, all times are sim time since boot
+  static constexpr int64_t LOOP_RATE_WINDOW_NS = 1000000000;
+  int64_t firmware_period_ns_ = 0; // Zero runs the firmware once per physics step
+  int64_t next_firmware_run_ns_ = 0;
+  int64_t last_update_ns_ = 0;
+  int64_t loop_rate_window_start_ns_ = 0;
+  uint32_t loop_rate_window_runs_ = 0;
 
   MAVForcesAndMoments * mav_dynamics_;
 
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file serial_link_model.hpp
+ * \author agent <agent@local>
+ */
+
+#ifndef ROSFLIGHT_SIM_SERIAL_LINK_MODEL_HPP
+#define ROSFLIGHT_SIM_SERIAL_LINK_MODEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+namespace rosflight_sim
+{
+/**
+ * @brief Model of one direction of a bandwidth limited serial link, such as a telemetry radio.
+ *
+ * Bytes written to the link wait in a bounded transmit buffer, and cross the link at the rate
+ * set by the baud rate (10 bits per byte, as with 8N1 framing). Bytes written while the buffer is
+ * full are dropped. Bytes crossing the link can be lost in bursts, following a Gilbert-Elliott
+ * model where every byte of a burst is lost.
+ *
+ * The model is driven by the timestamps passed in, so it runs on whatever clock the caller uses.
+ */
+class SerialLinkModel
+{
+public:
+  SerialLinkModel();
+
+  /**
+   * @brief Sets up the link model, discarding any bytes in it.
+   *
+   * @param baud_rate Link rate in bits per second, 0 for an unlimited rate.
+   * @param buffer_size Size of the transmit buffer in bytes, 0 for an unbounded buffer.
+   * @param burst_loss_probability Probability of a loss burst starting at each byte.
+   * @param mean_burst_length Average number of bytes lost in a burst.
+   * @param seed Seed for the loss model random numbers.
+   */
+  void configure(double baud_rate, size_t buffer_size, double burst_loss_probability,
+                 double mean_burst_length, uint32_t seed);
+
+  /**
+   * @brief Checks if the link does anything, or passes bytes straight through.
+   */
+  bool enabled() const { return bytes_per_ns_ > 0.0 || burst_start_probability_ > 0.0; }
+
+  /**
+   * @brief Writes bytes into the transmit buffer, dropping those that do not fit.
+   *
+   * @param now_ns Current time.
+   * @param src Bytes to write.
+   * @param len Number of bytes to write.
+   * @return Number of bytes that fit in the buffer.
+   */
+  size_t write(int64_t now_ns, const uint8_t * src, size_t len);
+
+  /**
+   * @brief Reads bytes that have crossed the link.
+   *
+   * @param now_ns Current time.
+   * @param dst Buffer to read the bytes into.
+   * @param max_len Size of the buffer.
+   * @return Number of bytes read.
+   */
+  size_t read(int64_t now_ns, uint8_t * dst, size_t max_len);
+
+  /**
+   * @brief Number of bytes dropped because the transmit buffer was full.
+   */
+  uint64_t overflow_drops() const { return overflow_drops_; }
+
+  /**
+   * @brief Number of bytes lost crossing the link.
+   */
+  uint64_t loss_drops() const { return loss_drops_; }
+
+private:
+  /**
+   * @brief Moves the bytes that have had time to cross the link out of the transmit buffer.
+   */
+  void update(int64_t now_ns);
+
+  double bytes_per_ns_;            // link rate, 0 for unlimited
+  size_t buffer_size_;             // transmit buffer size, 0 for unbounded
+  double burst_start_probability_; // probability of entering a loss burst at each byte
+  double burst_end_probability_;   // probability of leaving a loss burst at each byte
+  bool in_burst_;
+
+  std::deque<uint8_t> transmit_buffer_; // bytes waiting to cross the link
+  std::deque<uint8_t> received_;        // bytes that crossed the link, waiting to be read
+  double budget_;                       // bytes the link has had time to send, but not sent yet
+  int64_t last_update_ns_;
+  bool initialized_;
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+
+  uint64_t overflow_drops_;
+  uint64_t loss_drops_;
+};
+
+} // namespace rosflight_sim
+
+#endif // ROSFLIGHT_SIM_SERIAL_LINK_MODEL_HPP
@@ -40,6 +40,7 @@
 #include <cstdbool>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/common.hh>
@@ -51,6 +52,7 @@
 #include <rosflight_msgs/msg/rc_raw.hpp>
 
 #include <rosflight_sim/gz_compat.hpp>
+#include <rosflight_sim/serial_link_model.hpp>
 #include <rosflight_sim/udp_board.hpp>
 
 namespace rosflight_sim
@@ -74,8 +76,23 @@ private:
   double rc_update_rate_ = 0;
   double battery_update_rate_ = 0;
 
+  /**
+   * @brief Bytes received from UDPBoard together, and the sim time they were received at.
+   */
+  struct SerialChunk
+  {
+    int64_t receive_time_ns;
+    size_t len;
+  };
+
   long serial_delay_ns_ = 0;
-  std::queue<std::tuple<long, uint8_t>> serial_delay_queue_;
+  std::deque<SerialChunk> serial_delay_chunks_; // chunks still being delayed, oldest first
+  std::deque<uint8_t> serial_delay_bytes_;      // released bytes, then the bytes of every chunk
+  size_t serial_released_bytes_ = 0;            // bytes at the front that are done being delayed
+
+  SerialLinkModel uplink_;           // serial link from rosflight_io to the firmware
+  SerialLinkModel downlink_;         // serial link from the firmware to rosflight_io
+  uint64_t reported_link_drops_ = 0; // link drops already warned about
 
   double gyro_stdev_ = 0;
   double gyro_bias_walk_stdev_ = 0;
@@ -182,11 +199,23 @@ private:
    * @return true if throttle pwm is greater than 1100, false if less than or equal to.
    */
   bool motors_spinning();
+  /**
+   * @brief Current firmware time since boot in nanoseconds, the clock the firmware and the serial
+   * link run on. This is the time set with set_firmware_time_ns, or the sim time if it isn't set.
+   */
+  int64_t sim_time_ns();
+  /**
+   * @brief Moves received bytes through the uplink model into the serial delay line, releases the
+   * chunks that have been delayed for serial_delay_ns_ of sim time, and sends the bytes that have
+   * crossed the downlink model.
+   */
+  void update_serial_link();
 
   GazeboVector prev_vel_1_;
   GazeboVector prev_vel_2_;
   GazeboVector prev_vel_3_;
   gazebo::common::Time last_time_;
+  int64_t firmware_time_ns_ = -1; // Time the firmware loop is running at, negative for sim time
 
   float battery_voltage_multiplier{1.0};
   float battery_current_multiplier{1.0};
@@ -223,6 +252,18 @@ public:
    * @brief Function required to be overridden, but not used by sim.
    */
   void clock_delay(uint32_t milliseconds) override{};
+  /**
+   * @brief Gets the current Gazebo sim time since boot in nanoseconds, ignoring any time set with
+   * set_firmware_time_ns.
+   */
+  int64_t gazebo_time_ns();
+  /**
+   * @brief Pins the FCU clock to a time since boot, so that each firmware loop run within a physics
+   * step sees the time it was scheduled at.
+   *
+   * @param time_ns Time since boot in nanoseconds, or a negative value to follow sim time again.
+   */
+  void set_firmware_time_ns(int64_t time_ns) { firmware_time_ns_ = time_ns; }
 
   // serial
   /**
@@ -234,9 +275,22 @@ public:
    * @brief Function to check if bytes are in the serial communication buffer. Overriden to
    * implement a serial delay for simulation purposes.
    *
-   * @return true if bytes are ready.
+   * @return Number of bytes whose delay has passed.
    */
   uint16_t serial_bytes_available() override;
+  /**
+   * @brief Reads every byte whose delay has passed that fits in a buffer, in one call.
+   *
+   * @param dst Buffer to read the bytes into.
+   * @param max_len Size of the buffer.
+   * @return Number of bytes read.
+   */
+  size_t serial_read_bulk(uint8_t * dst, size_t max_len) override;
+  /**
+   * @brief Function that is called in firmware loop to write to the serial port. Overriden to
+   * limit the bandwidth of the link for simulation purposes.
+   */
+  void serial_write(const uint8_t * src, size_t len, uint8_t qos) override;
 
   // sensors
   /**
@@ -46,6 +46,8 @@
 #include "board.h"
 #include "mavlink/mavlink.h"
 
+#include <rosflight_sim/byte_ring.hpp>
+
 namespace rosflight_sim
 {
 class UDPBoard : public rosflight_firmware::Board
@@ -61,6 +63,15 @@ public:
   uint8_t serial_read() override;
   void serial_flush() override;
 
+  /**
+   * @brief Reads every received byte that fits in a buffer, in one call.
+   *
+   * @param dst Buffer to read the bytes into.
+   * @param max_len Size of the buffer.
+   * @return Number of bytes read.
+   */
+  virtual size_t serial_read_bulk(uint8_t * dst, size_t max_len);
+
   void set_ports(std::string bind_host, uint16_t bind_port, std::string remote_host,
                  uint16_t remote_port);
 
@@ -94,6 +105,9 @@ private:
 
   typedef boost::lock_guard<boost::recursive_mutex> MutexLock;
 
+  /// Size of the receive ring, enough for a few hundred full MAVLink packets.
+  static constexpr size_t READ_RING_SIZE = 1 << 16;
+
   void async_read();
   void async_read_end(const boost::system::error_code & error, size_t bytes_transferred);
 
@@ -108,7 +122,6 @@ private:
 
   boost::thread io_thread_;
   boost::recursive_mutex write_mutex_;
-  boost::recursive_mutex read_mutex_;
 
   boost::asio::io_service io_service_;
 
@@ -117,7 +130,8 @@ private:
   boost::asio::ip::udp::endpoint remote_endpoint_;
 
   uint8_t read_buffer_[MAVLINK_MAX_PACKET_LEN] = {0};
-  std::list<Buffer *> read_queue_;
+  /// Received bytes, written by the io thread and read by the firmware thread.
+  ByteRing<READ_RING_SIZE> read_ring_;
 
   std::list<Buffer *> write_queue_;
   bool write_in_progress_;
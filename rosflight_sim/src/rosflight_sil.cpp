@@ -34,6 +34,7 @@
 
 #pragma GCC diagnostic ignored "-Wwrite-strings"
 
+#include <cmath>
 #include <sstream>
 
 #include <eigen3/Eigen/Core>
@@ -92,6 +93,12 @@ void ROSflightSIL::Load(gazebo::physics::ModelPtr _model, sdf::ElementPtr _sdf)
   board_.gazebo_setup(link_, world_, model_, node_, mav_type_);
   firmware_.init();
 
+  double firmware_loop_rate = node_->get_parameter_or<double>("firmware_loop_rate", 2000.0);
+  firmware_period_ns_ = firmware_loop_rate > 0.0 ? std::llround(1e9 / firmware_loop_rate) : 0;
+  next_firmware_run_ns_ = board_.gazebo_time_ns();
+  last_update_ns_ = next_firmware_run_ns_;
+  loop_rate_window_start_ns_ = next_firmware_run_ns_;
+
   // Connect the update function to the simulation
   updateConnection_ =
     gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&ROSflightSIL::OnUpdate, this, _1));
@@ -100,6 +107,7 @@ void ROSflightSIL::Load(gazebo::physics::ModelPtr _model, sdf::ElementPtr _sdf)
 
   truth_NED_pub_ = node_->create_publisher<nav_msgs::msg::Odometry>("truth/NED", 1);
   truth_NWU_pub_ = node_->create_publisher<nav_msgs::msg::Odometry>("truth/NWU", 1);
+  loop_rate_pub_ = node_->create_publisher<std_msgs::msg::Float64>("firmware_loop_rate", 1);
 }
 
 void ROSflightSIL::declare_SIL_params()
@@ -109,7 +117,13 @@ void ROSflightSIL::declare_SIL_params()
   node_->declare_parameter("ROS_host", rclcpp::PARAMETER_STRING);
   node_->declare_parameter("ROS_port", rclcpp::PARAMETER_INTEGER);
 
+  node_->declare_parameter("firmware_loop_rate", rclcpp::PARAMETER_DOUBLE);
+
   node_->declare_parameter("serial_delay_ns", rclcpp::PARAMETER_INTEGER);
+  node_->declare_parameter("serial_baud_rate", rclcpp::PARAMETER_DOUBLE);
+  node_->declare_parameter("serial_buffer_size", rclcpp::PARAMETER_INTEGER);
+  node_->declare_parameter("serial_burst_loss_probability", rclcpp::PARAMETER_DOUBLE);
+  node_->declare_parameter("serial_burst_loss_length", rclcpp::PARAMETER_DOUBLE);
 
   node_->declare_parameter("gyro_stdev", rclcpp::PARAMETER_DOUBLE);
   node_->declare_parameter("gyro_bias_range", rclcpp::PARAMETER_DOUBLE);
@@ -152,9 +166,7 @@ void ROSflightSIL::declare_SIL_params()
 // This gets called by the world update event.
 void ROSflightSIL::OnUpdate(const gazebo::common::UpdateInfo & _info)
 {
-  // We run twice so that that functions that take place when we don't have new IMU data get run
-  firmware_.run();
-  firmware_.run();
+  run_firmware();
 
   Eigen::Matrix3d NWU_to_NED;
   NWU_to_NED << 1, 0, 0, 0, -1, 0, 0, 0, -1;
@@ -182,6 +194,41 @@ void ROSflightSIL::OnUpdate(const gazebo::common::UpdateInfo & _info)
   publish_truth();
 }
 
+void ROSflightSIL::run_firmware()
+{
+  int64_t now_ns = board_.gazebo_time_ns();
+  if (now_ns < last_update_ns_) {
+    // Sim time went backwards, so the world was reset
+    next_firmware_run_ns_ = now_ns;
+    loop_rate_window_start_ns_ = now_ns;
+    loop_rate_window_runs_ = 0;
+  }
+  last_update_ns_ = now_ns;
+
+  if (firmware_period_ns_ > 0) {
+    // Sub-step through the physics step, with the board clock set to the time of each loop
+    while (next_firmware_run_ns_ <= now_ns) {
+      board_.set_firmware_time_ns(next_firmware_run_ns_);
+      firmware_.run();
+      next_firmware_run_ns_ += firmware_period_ns_;
+      loop_rate_window_runs_++;
+    }
+    board_.set_firmware_time_ns(-1);
+  } else {
+    firmware_.run();
+    loop_rate_window_runs_++;
+  }
+
+  int64_t window_ns = now_ns - loop_rate_window_start_ns_;
+  if (window_ns >= LOOP_RATE_WINDOW_NS) {
+    std_msgs::msg::Float64 loop_rate;
+    loop_rate.data = loop_rate_window_runs_ * 1e9 / window_ns;
+    loop_rate_pub_->publish(loop_rate);
+    loop_rate_window_start_ns_ = now_ns;
+    loop_rate_window_runs_ = 0;
+  }
+}
+
 void ROSflightSIL::Reset()
 {
   link_->SetWorldPose(initial_pose_);
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file serial_link_model.cpp
+ * \author agent <agent@local>
+ */
+
+#include "rosflight_sim/serial_link_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rosflight_sim
+{
+SerialLinkModel::SerialLinkModel()
+    : bytes_per_ns_(0.0)
+    , buffer_size_(0)
+    , burst_start_probability_(0.0)
+    , burst_end_probability_(1.0)
+    , in_burst_(false)
+    , budget_(0.0)
+    , last_update_ns_(0)
+    , initialized_(false)
+    , uniform_(0.0, 1.0)
+    , overflow_drops_(0)
+    , loss_drops_(0)
+{}
+
+void SerialLinkModel::configure(double baud_rate, size_t buffer_size,
+                                double burst_loss_probability, double mean_burst_length,
+                                uint32_t seed)
+{
+  // 8N1 framing sends a start and stop bit with every byte
+  bytes_per_ns_ = std::max(baud_rate, 0.0) / 10.0 / 1e9;
+  buffer_size_ = buffer_size;
+  burst_start_probability_ = std::clamp(burst_loss_probability, 0.0, 1.0);
+  burst_end_probability_ = 1.0 / std::max(mean_burst_length, 1.0);
+  in_burst_ = false;
+
+  transmit_buffer_.clear();
+  received_.clear();
+  budget_ = 0.0;
+  initialized_ = false;
+  generator_.seed(seed);
+  overflow_drops_ = 0;
+  loss_drops_ = 0;
+}
+
+size_t SerialLinkModel::write(int64_t now_ns, const uint8_t * src, size_t len)
+{
+  // account for the time the link was idle before these bytes arrived
+  update(now_ns);
+
+  size_t accepted = len;
+  if (buffer_size_ > 0) {
+    accepted = std::min(len, buffer_size_ - std::min(buffer_size_, transmit_buffer_.size()));
+  }
+  transmit_buffer_.insert(transmit_buffer_.end(), src, src + accepted);
+  overflow_drops_ += len - accepted;
+  return accepted;
+}
+
+size_t SerialLinkModel::read(int64_t now_ns, uint8_t * dst, size_t max_len)
+{
+  update(now_ns);
+
+  size_t len = std::min(max_len, received_.size());
+  std::copy_n(received_.begin(), len, dst);
+  received_.erase(received_.begin(), received_.begin() + len);
+  return len;
+}
+
+void SerialLinkModel::update(int64_t now_ns)
+{
+  // start over if the clock went backwards (e.g. the sim was reset)
+  if (!initialized_ || now_ns < last_update_ns_) {
+    last_update_ns_ = now_ns;
+    budget_ = 0.0;
+    initialized_ = true;
+  }
+
+  size_t len = transmit_buffer_.size();
+  if (bytes_per_ns_ > 0.0) {
+    budget_ += (now_ns - last_update_ns_) * bytes_per_ns_;
+    len = std::min(len, (size_t) std::floor(budget_));
+    budget_ -= len;
+  }
+  last_update_ns_ = now_ns;
+
+  for (size_t i = 0; i < len; i++) {
+    uint8_t byte = transmit_buffer_.front();
+    transmit_buffer_.pop_front();
+
+    if (burst_start_probability_ > 0.0) {
+      in_burst_ = in_burst_ ? uniform_(generator_) >= burst_end_probability_
+                            : uniform_(generator_) < burst_start_probability_;
+    }
+    if (in_burst_) {
+      loss_drops_++;
+    } else {
+      received_.push_back(byte);
+    }
+  }
+
+  // an idle link can not save up time to send a later burst of bytes faster
+  if (transmit_buffer_.empty()) {
+    budget_ = std::min(budget_, 1.0);
+  }
+}
+
+} // namespace rosflight_sim
@@ -34,6 +34,7 @@
  */
 
 #include "rosflight_sim/gz_compat.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <fstream>
@@ -83,6 +84,17 @@ void SILBoard::gazebo_setup(gazebo::physics::LinkPtr link, gazebo::physics::Worl
   // Get communication delay parameters, in nanoseconds
   serial_delay_ns_ = node_->get_parameter_or<long>("serial_delay_ns", 0.006 * 1e9);
 
+  // Get serial link parameters. Both directions share them, with fixed seeds so runs repeat.
+  double serial_baud_rate = node_->get_parameter_or<double>("serial_baud_rate", 0.0);
+  int serial_buffer_size = node_->get_parameter_or<int>("serial_buffer_size", 4096);
+  double serial_burst_loss_probability =
+    node_->get_parameter_or<double>("serial_burst_loss_probability", 0.0);
+  double serial_burst_loss_length = node_->get_parameter_or<double>("serial_burst_loss_length", 64);
+  uplink_.configure(serial_baud_rate, std::max(serial_buffer_size, 0),
+                    serial_burst_loss_probability, serial_burst_loss_length, 1);
+  downlink_.configure(serial_baud_rate, std::max(serial_buffer_size, 0),
+                      serial_burst_loss_probability, serial_burst_loss_length, 2);
+
   // Get Sensor Parameters
   gyro_stdev_ = node_->get_parameter_or<double>("gyro_stdev", 0.0226);
   gyro_bias_range_ = node_->get_parameter_or<double>("gyro_bias_range", 0.25);
@@ -181,37 +193,121 @@ void SILBoard::gazebo_setup(gazebo::physics::LinkPtr link, gazebo::physics::Worl
 
 uint32_t SILBoard::clock_millis()
 {
-  uint32_t millis = (uint32_t) ((GZ_COMPAT_GET_SIM_TIME(world_) - boot_time_).Double() * 1e3);
+  uint32_t millis = (uint32_t) (sim_time_ns() / 1000000);
   return millis;
 }
 
 uint64_t SILBoard::clock_micros()
 {
-  uint64_t micros = (uint64_t) ((GZ_COMPAT_GET_SIM_TIME(world_) - boot_time_).Double() * 1e6);
+  uint64_t micros = (uint64_t) (sim_time_ns() / 1000);
   return micros;
 }
 
+int64_t SILBoard::gazebo_time_ns()
+{
+  gazebo::common::Time time = GZ_COMPAT_GET_SIM_TIME(world_) - boot_time_;
+  return (int64_t) time.sec * 1000000000 + time.nsec;
+}
+
 uint8_t SILBoard::serial_read()
 {
-  auto next_message = serial_delay_queue_.front();
-  serial_delay_queue_.pop();
-  return std::get<1>(next_message);
+  if (serial_released_bytes_ == 0) {
+    return 0;
+  }
+
+  uint8_t byte = serial_delay_bytes_.front();
+  serial_delay_bytes_.pop_front();
+  serial_released_bytes_--;
+  return byte;
 }
 
 uint16_t SILBoard::serial_bytes_available()
 {
-  // Get current time. Doesn't use ROS time as ROS time proved to be inconsistent and lead to slower
-  // serial communication.
-  auto current_time = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  update_serial_link();
+  return (uint16_t) std::min(serial_released_bytes_, (size_t) UINT16_MAX);
+}
+
+size_t SILBoard::serial_read_bulk(uint8_t * dst, size_t max_len)
+{
+  update_serial_link();
+
+  size_t len = std::min(max_len, serial_released_bytes_);
+  std::copy_n(serial_delay_bytes_.begin(), len, dst);
+  serial_delay_bytes_.erase(serial_delay_bytes_.begin(), serial_delay_bytes_.begin() + len);
+  serial_released_bytes_ -= len;
+  return len;
+}
+
+void SILBoard::serial_write(const uint8_t * src, size_t len, uint8_t qos)
+{
+  if (!downlink_.enabled()) {
+    UDPBoard::serial_write(src, len, qos);
+    return;
+  }
+
+  downlink_.write(sim_time_ns(), src, len);
+  update_serial_link();
+}
+
+int64_t SILBoard::sim_time_ns()
+{
+  return firmware_time_ns_ >= 0 ? firmware_time_ns_ : gazebo_time_ns();
+}
+
+void SILBoard::update_serial_link()
+{
+  // Use sim time, so the link behaves the same when the sim runs faster or slower than real time
+  int64_t now_ns = sim_time_ns();
 
-  // Get available serial_read messages from the firmware
-  if (UDPBoard::serial_bytes_available()) {
-    serial_delay_queue_.emplace(current_time, UDPBoard::serial_read());
+  // Send what has crossed the downlink
+  uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+  size_t len;
+  if (downlink_.enabled()) {
+    while ((len = downlink_.read(now_ns, buffer, sizeof(buffer))) > 0) {
+      UDPBoard::serial_write(buffer, len, 0);
+    }
   }
 
-  // Determine if there are any serial_read messages that are ready for processing
-  return !serial_delay_queue_.empty()
-    && (current_time - std::get<0>(serial_delay_queue_.front())) > serial_delay_ns_;
+  // Everything received since the last call arrived together, so it is timestamped as one chunk
+  size_t chunk_len = 0;
+  while ((len = UDPBoard::serial_read_bulk(buffer, sizeof(buffer))) > 0) {
+    if (uplink_.enabled()) {
+      uplink_.write(now_ns, buffer, len);
+    } else {
+      serial_delay_bytes_.insert(serial_delay_bytes_.end(), buffer, buffer + len);
+      chunk_len += len;
+    }
+  }
+  if (uplink_.enabled()) {
+    while ((len = uplink_.read(now_ns, buffer, sizeof(buffer))) > 0) {
+      serial_delay_bytes_.insert(serial_delay_bytes_.end(), buffer, buffer + len);
+      chunk_len += len;
+    }
+  }
+  if (chunk_len > 0) {
+    serial_delay_chunks_.push_back({now_ns, chunk_len});
+  }
+
+  // Release whole chunks once they are old enough, or if sim time went backwards (world reset)
+  while (!serial_delay_chunks_.empty()) {
+    int64_t age_ns = now_ns - serial_delay_chunks_.front().receive_time_ns;
+    if (age_ns >= 0 && age_ns < serial_delay_ns_) {
+      break;
+    }
+    serial_released_bytes_ += serial_delay_chunks_.front().len;
+    serial_delay_chunks_.pop_front();
+  }
+
+  uint64_t link_drops = uplink_.overflow_drops() + uplink_.loss_drops()
+    + downlink_.overflow_drops() + downlink_.loss_drops();
+  if (link_drops > reported_link_drops_) {
+    RCLCPP_WARN_THROTTLE(node_->get_logger(), *node_->get_clock(), 1000,
+                         "Serial link dropped bytes: uplink %lu overflow, %lu lost; downlink %lu "
+                         "overflow, %lu lost",
+                         uplink_.overflow_drops(), uplink_.loss_drops(),
+                         downlink_.overflow_drops(), downlink_.loss_drops());
+    reported_link_drops_ = link_drops;
+  }
 }
 
 // sensors
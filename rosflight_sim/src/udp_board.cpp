@@ -35,6 +35,8 @@
  */
 
 #include "rosflight_sim/udp_board.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 
 using boost::asio::ip::udp;
@@ -54,7 +56,6 @@ UDPBoard::UDPBoard(std::string bind_host, uint16_t bind_port, std::string remote
 
 UDPBoard::~UDPBoard()
 {
-  MutexLock read_lock(read_mutex_);
   MutexLock write_lock(write_mutex_);
 
   io_service_.stop();
@@ -114,35 +115,27 @@ void UDPBoard::serial_write(const uint8_t * src, size_t len, uint8_t qos)
 
 uint16_t UDPBoard::serial_bytes_available()
 {
-  MutexLock lock(read_mutex_);
-  return !read_queue_.empty(); //! \todo This should return a number, not a bool
+  return (uint16_t) std::min(read_ring_.size(), (size_t) UINT16_MAX);
 }
 
 uint8_t UDPBoard::serial_read()
 {
-  MutexLock lock(read_mutex_);
-
-  if (read_queue_.empty()) {
-    return 0;
-  }
-
-  Buffer * buffer = read_queue_.front();
-  uint8_t byte = buffer->consume_byte();
-
-  if (buffer->empty()) {
-    read_queue_.pop_front();
-    delete buffer;
-  }
+  uint8_t byte = 0;
+  read_ring_.read(&byte, 1);
   return byte;
 }
 
+size_t UDPBoard::serial_read_bulk(uint8_t * dst, size_t max_len)
+{
+  return read_ring_.read(dst, max_len);
+}
+
 void UDPBoard::async_read()
 {
   if (!socket_.is_open()) {
     return;
   }
 
-  MutexLock lock(read_mutex_);
   socket_.async_receive_from(
     boost::asio::buffer(read_buffer_, MAVLINK_MAX_PACKET_LEN), remote_endpoint_,
     boost::bind(&UDPBoard::async_read_end, this, boost::asio::placeholders::error,
@@ -151,9 +144,9 @@ void UDPBoard::async_read()
 
 void UDPBoard::async_read_end(const boost::system::error_code & error, size_t bytes_transferred)
 {
+  // a datagram that does not fit is dropped whole, so the firmware never sees a partial packet
   if (!error) {
-    MutexLock lock(read_mutex_);
-    read_queue_.push_back(new Buffer(read_buffer_, bytes_transferred));
+    read_ring_.write(read_buffer_, bytes_transferred);
   }
   async_read();
 }